@@ -0,0 +1,352 @@
+//*****************************************************************************
+//
+//  compressed.cpp
+//  CSCI 463 Assignment 5
+//
+//  Created by Daniel Widing (z1838064)
+//
+//*****************************************************************************
+#include "compressed.h"
+#include "rv32i.h"
+
+//Quadrants, the low 2 bits of a compressed instruction
+static constexpr uint32_t quadrant_0 = 0b00;
+static constexpr uint32_t quadrant_1 = 0b01;
+static constexpr uint32_t quadrant_2 = 0b10;
+
+static constexpr uint32_t reg_ra = 1;
+static constexpr uint32_t reg_sp = 2;
+
+/**
+ * Gets bits hi down to lo of a compressed instruction
+ *
+ * @param insn: compressed instruction
+ * @param   hi: highest bit wanted
+ * @param   lo: lowest bit wanted
+ *
+ * @return: the bits, shifted down to bit 0
+ **/
+static uint32_t bits(uint32_t insn, uint32_t hi, uint32_t lo)
+{
+	return (insn >> lo) & ((1u << (hi - lo + 1)) - 1);
+}
+
+/**
+ * Sign-extends the low bits of a value
+ *
+ * @param   val: value to extend
+ * @param width: how many low bits hold the signed value
+ *
+ * @return: the sign-extended value
+ **/
+static int32_t sext(uint32_t val, uint32_t width)
+{
+	uint32_t sign = 1u << (width - 1);
+	return static_cast<int32_t>((val ^ sign) - sign);
+}
+
+/**
+ * Gets a 3 bit register field, which names one of x8-x15
+ *
+ * @param insn: compressed instruction
+ * @param   lo: lowest bit of the field
+ *
+ * @return: the full register number
+ **/
+static uint32_t creg(uint32_t insn, uint32_t lo)
+{
+	return 8 + bits(insn, lo + 2, lo);
+}
+
+//Builders for each 32 bit format, from fields already in range
+static uint32_t itype(uint32_t imm, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode)
+{
+	return ((imm & 0xfff) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+}
+
+static uint32_t stype(uint32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t opcode)
+{
+	return (((imm >> 5) & 0x7f) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | ((imm & 0x1f) << 7) | opcode;
+}
+
+static uint32_t btype(uint32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3)
+{
+	return (((imm >> 12) & 1) << 31) | (((imm >> 5) & 0x3f) << 25) | (rs2 << 20) | (rs1 << 15)
+		| (funct3 << 12) | (((imm >> 1) & 0xf) << 8) | (((imm >> 11) & 1) << 7) | opcode_btype;
+}
+
+static uint32_t jtype(uint32_t imm, uint32_t rd)
+{
+	return (((imm >> 20) & 1) << 31) | (((imm >> 1) & 0x3ff) << 21) | (((imm >> 11) & 1) << 20)
+		| (((imm >> 12) & 0xff) << 12) | (rd << 7) | opcode_jal;
+}
+
+static uint32_t rtype(uint32_t funct7, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t rd)
+{
+	return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode_rtype;
+}
+
+/**
+ * Gets the offset of c.j and c.jal, imm[11|4|9:8|10|6|7|3:1|5] in bits 12-2
+ *
+ * @param insn: compressed instruction
+ *
+ * @return: sign-extended offset
+ **/
+static int32_t cj_offset(uint32_t insn)
+{
+	uint32_t imm = (bits(insn, 12, 12) << 11) | (bits(insn, 11, 11) << 4) | (bits(insn, 10, 9) << 8)
+		| (bits(insn, 8, 8) << 10) | (bits(insn, 7, 7) << 6) | (bits(insn, 6, 6) << 7)
+		| (bits(insn, 5, 3) << 1) | (bits(insn, 2, 2) << 5);
+	return sext(imm, 12);
+}
+
+/**
+ * Gets the offset of c.beqz and c.bnez, imm[8|4:3] in bits 12-10 and
+ * imm[7:6|2:1|5] in bits 6-2
+ *
+ * @param insn: compressed instruction
+ *
+ * @return: sign-extended offset
+ **/
+static int32_t cb_offset(uint32_t insn)
+{
+	uint32_t imm = (bits(insn, 12, 12) << 8) | (bits(insn, 11, 10) << 3) | (bits(insn, 6, 5) << 6)
+		| (bits(insn, 4, 3) << 1) | (bits(insn, 2, 2) << 5);
+	return sext(imm, 9);
+}
+
+/**
+ * Gets the 6 bit signed immediate most quadrant 1 instructions use, imm[5] in
+ * bit 12 and imm[4:0] in bits 6-2
+ *
+ * @param insn: compressed instruction
+ *
+ * @return: sign-extended immediate
+ **/
+static int32_t ci_imm(uint32_t insn)
+{
+	return sext((bits(insn, 12, 12) << 5) | bits(insn, 6, 2), 6);
+}
+
+/**
+ * Expands quadrant 0: the stack pointer add and the register based loads and
+ * stores
+ *
+ * @param insn: compressed instruction
+ *
+ * @return: the 32 bit instruction, or 0 if illegal
+ **/
+static uint32_t expand_quadrant_0(uint32_t insn)
+{
+	//uimm[5:3] in bits 12-10, uimm[2] in bit 6 and uimm[6] in bit 5
+	uint32_t lw_offset = (bits(insn, 12, 10) << 3) | (bits(insn, 6, 6) << 2) | (bits(insn, 5, 5) << 6);
+
+	switch (bits(insn, 15, 13))
+	{
+	default:
+		//Floating point loads and stores, and reserved
+		return 0;
+	case 0b000:
+	{
+		//c.addi4spn: nzuimm[5:4|9:6|2|3] in bits 12-5
+		uint32_t imm = (bits(insn, 12, 11) << 4) | (bits(insn, 10, 7) << 6) | (bits(insn, 6, 6) << 2) | (bits(insn, 5, 5) << 3);
+		if (imm == 0)
+		{
+			return 0;
+		}
+		return itype(imm, reg_sp, funct3_addi, creg(insn, 2), opcode_itype_alu);
+	}
+	case 0b010:
+		//c.lw
+		return itype(lw_offset, creg(insn, 7), funct3_lw, creg(insn, 2), opcode_itype_load);
+	case 0b110:
+		//c.sw
+		return stype(lw_offset, creg(insn, 2), creg(insn, 7), funct3_sw, opcode_stype);
+	}
+}
+
+/**
+ * Expands quadrant 1: immediates, register to register arithmetic on x8-x15,
+ * jumps and branches
+ *
+ * @param insn: compressed instruction
+ *
+ * @return: the 32 bit instruction, or 0 if illegal
+ **/
+static uint32_t expand_quadrant_1(uint32_t insn)
+{
+	uint32_t rd = bits(insn, 11, 7);
+	uint32_t rdc = creg(insn, 7);
+
+	switch (bits(insn, 15, 13))
+	{
+	default:
+	case 0b000:
+		//c.addi, c.nop when rd is x0
+		return itype(ci_imm(insn), rd, funct3_addi, rd, opcode_itype_alu);
+	case 0b001:
+		//c.jal
+		return jtype(cj_offset(insn), reg_ra);
+	case 0b010:
+		//c.li
+		return itype(ci_imm(insn), 0, funct3_addi, rd, opcode_itype_alu);
+	case 0b011:
+		if (rd == reg_sp)
+		{
+			//c.addi16sp: nzimm[9] in bit 12, nzimm[4|6|8:7|5] in bits 6-2
+			uint32_t imm = (bits(insn, 12, 12) << 9) | (bits(insn, 6, 6) << 4) | (bits(insn, 5, 5) << 6)
+				| (bits(insn, 4, 3) << 7) | (bits(insn, 2, 2) << 5);
+			if (imm == 0)
+			{
+				return 0;
+			}
+			return itype(sext(imm, 10), reg_sp, funct3_addi, reg_sp, opcode_itype_alu);
+		}
+		else
+		{
+			//c.lui: nzimm[17] in bit 12, nzimm[16:12] in bits 6-2
+			int32_t imm = ci_imm(insn);
+			if (imm == 0)
+			{
+				return 0;
+			}
+			return (static_cast<uint32_t>(imm) << 12) | (rd << 7) | opcode_lui;
+		}
+	case 0b100:
+		switch (bits(insn, 11, 10))
+		{
+		default:
+		case 0b00:
+		case 0b01:
+		{
+			//c.srli and c.srai, shamt[5] must be 0 on RV32
+			if (bits(insn, 12, 12) != 0)
+			{
+				return 0;
+			}
+			uint32_t funct7 = bits(insn, 11, 10) == 0b00 ? funct7_srli : funct7_srai;
+			return itype((funct7 << 5) | bits(insn, 6, 2), rdc, funct3_sr, rdc, opcode_itype_alu);
+		}
+		case 0b10:
+			//c.andi
+			return itype(ci_imm(insn), rdc, funct3_andi, rdc, opcode_itype_alu);
+		case 0b11:
+		{
+			//c.sub, c.xor, c.or and c.and; the rest are RV64 only
+			if (bits(insn, 12, 12) != 0)
+			{
+				return 0;
+			}
+			uint32_t rs2 = creg(insn, 2);
+			switch (bits(insn, 6, 5))
+			{
+			default:
+			case 0b00:
+				return rtype(funct7_sub, rs2, rdc, funct3_addsub, rdc);
+			case 0b01:
+				return rtype(0, rs2, rdc, funct3_xor, rdc);
+			case 0b10:
+				return rtype(0, rs2, rdc, funct3_or, rdc);
+			case 0b11:
+				return rtype(0, rs2, rdc, funct3_and, rdc);
+			}
+		}
+		}
+	case 0b101:
+		//c.j
+		return jtype(cj_offset(insn), 0);
+	case 0b110:
+		//c.beqz
+		return btype(cb_offset(insn), 0, rdc, funct3_beq);
+	case 0b111:
+		//c.bnez
+		return btype(cb_offset(insn), 0, rdc, funct3_bne);
+	}
+}
+
+/**
+ * Expands quadrant 2: shifts, stack pointer loads and stores, moves, adds,
+ * register jumps and ebreak
+ *
+ * @param insn: compressed instruction
+ *
+ * @return: the 32 bit instruction, or 0 if illegal
+ **/
+static uint32_t expand_quadrant_2(uint32_t insn)
+{
+	uint32_t rd = bits(insn, 11, 7);
+	uint32_t rs2 = bits(insn, 6, 2);
+
+	switch (bits(insn, 15, 13))
+	{
+	default:
+		//Floating point loads and stores
+		return 0;
+	case 0b000:
+		//c.slli, shamt[5] must be 0 on RV32
+		if (bits(insn, 12, 12) != 0)
+		{
+			return 0;
+		}
+		return itype(rs2, rd, funct3_slli, rd, opcode_itype_alu);
+	case 0b010:
+	{
+		//c.lwsp: uimm[5] in bit 12, uimm[4:2|7:6] in bits 6-2
+		if (rd == 0)
+		{
+			return 0;
+		}
+		uint32_t imm = (bits(insn, 12, 12) << 5) | (bits(insn, 6, 4) << 2) | (bits(insn, 3, 2) << 6);
+		return itype(imm, reg_sp, funct3_lw, rd, opcode_itype_load);
+	}
+	case 0b100:
+		if (bits(insn, 12, 12) == 0)
+		{
+			if (rs2 == 0)
+			{
+				//c.jr
+				return rd == 0 ? 0 : itype(0, rd, 0, 0, opcode_jalr);
+			}
+			//c.mv
+			return rtype(funct7_add, rs2, 0, funct3_addsub, rd);
+		}
+		if (rs2 == 0)
+		{
+			//c.ebreak, or c.jalr
+			return rd == 0 ? insn_ebreak : itype(0, rd, 0, reg_ra, opcode_jalr);
+		}
+		//c.add
+		return rtype(funct7_add, rs2, rd, funct3_addsub, rd);
+	case 0b110:
+	{
+		//c.swsp: uimm[5:2|7:6] in bits 12-7
+		uint32_t imm = (bits(insn, 12, 9) << 2) | (bits(insn, 8, 7) << 6);
+		return stype(imm, rs2, reg_sp, funct3_sw, opcode_stype);
+	}
+	}
+}
+
+/**
+ * Expands a 16 bit compressed instruction into the 32 bit instruction that
+ * does the same thing, so it can be decoded and run like any other
+ *
+ * @param insn: compressed instruction
+ *
+ * @return: the 32 bit instruction, or 0 (which is not an instruction) if the
+ *          compressed instruction is illegal or not supported
+ **/
+uint32_t expand_compressed(uint16_t insn)
+{
+	switch (insn & 0b11)
+	{
+	default:
+		return 0;
+	case quadrant_0:
+		return expand_quadrant_0(insn);
+	case quadrant_1:
+		return expand_quadrant_1(insn);
+	case quadrant_2:
+		return expand_quadrant_2(insn);
+	}
+}
@@ -0,0 +1,29 @@
+//*****************************************************************************
+//
+//  compressed.h
+//  CSCI 463 Assignment 5
+//
+//  Created by Daniel Widing (z1838064)
+//
+//*****************************************************************************
+#ifndef compressed_H
+#define compressed_H
+
+#include <stdint.h>
+
+/**
+ * Tells whether an instruction starting with the passed 16 bits is a 16 bit
+ * compressed instruction. Every 32 bit instruction has 11 in its low 2 bits.
+ *
+ * @param parcel: first 16 bits of the instruction
+ *
+ * @return: true if compressed
+ **/
+inline bool is_compressed(uint32_t parcel)
+{
+	return (parcel & 0b11) != 0b11;
+}
+
+uint32_t expand_compressed(uint16_t insn);
+
+#endif
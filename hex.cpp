@@ -6,17 +6,86 @@
 //  Created by Daniel Widing (z1838064)
 //
 //*****************************************************************************
-#include <iostream>
-#include <iomanip>
-#include <cstdlib>
-#include <cmath>
 #include <string>
-#include <sstream>
+#include <cstring>
 
 #include "hex.h"
 
 using namespace std;
 
+//The 2 lowercase hex digits of every byte value, in order
+static const char hex_digits[] =
+	"000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+	"202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+	"404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+	"606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+	"808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+	"a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+	"c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+	"e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+/**
+ * Writes 2 hex digits of 8 bit input to a buffer, without a terminating null
+ *
+ * @param buf: where to write, room for hex8_len characters
+ * @param   i: 8 bits to be written as hex
+ *
+ * @return: pointer just past the digits written
+ **/
+char* hex8(char* buf, uint8_t i)
+{
+	memcpy(buf, &hex_digits[2 * i], 2);
+	return buf + hex8_len;
+}
+
+/**
+ * Writes 4 hex digits of 16 bit input to a buffer, without a terminating null
+ *
+ * @param buf: where to write, room for hex16_len characters
+ * @param   i: 16 bits to be written as hex
+ *
+ * @return: pointer just past the digits written
+ **/
+char* hex16(char* buf, uint16_t i)
+{
+	hex8(buf + 0, i >> 8);
+	hex8(buf + 2, i);
+	return buf + hex16_len;
+}
+
+/**
+ * Writes 8 hex digits of 32 bit input to a buffer, without a terminating null
+ *
+ * @param buf: where to write, room for hex32_len characters
+ * @param   i: 32 bits to be written as hex
+ *
+ * @return: pointer just past the digits written
+ **/
+char* hex32(char* buf, uint32_t i)
+{
+	hex8(buf + 0, i >> 24);
+	hex8(buf + 2, i >> 16);
+	hex8(buf + 4, i >> 8);
+	hex8(buf + 6, i);
+	return buf + hex32_len;
+}
+
+/**
+ * Writes 8 hex digits of 32 bit input with leading 0x to a buffer, without a
+ * terminating null
+ *
+ * @param buf: where to write, room for hex0x32_len characters
+ * @param   i: 32 bits to be written as hex
+ *
+ * @return: pointer just past the digits written
+ **/
+char* hex0x32(char* buf, uint32_t i)
+{
+	buf[0] = '0';
+	buf[1] = 'x';
+	return hex32(buf + 2, i);
+}
+
 /**
  * Returns 2 hex digits of 8 bit input
  * 
@@ -26,9 +95,8 @@ using namespace std;
  **/
 string hex8(uint8_t i)
 {
-	ostringstream os;
-	os << hex << setfill('0') << setw(2) << static_cast<uint16_t>(i); 
-	return os.str();
+	char buf[hex8_len];
+	return string(buf, hex8(buf, i));
 }
 
 /**
@@ -40,20 +108,19 @@ string hex8(uint8_t i)
  **/
 string hex32(uint32_t i)
 {
-	ostringstream os;
-	os << hex << setfill('0') << setw(8) << static_cast<uint32_t>(i);
-	return os.str();
+	char buf[hex32_len];
+	return string(buf, hex32(buf, i));
 }
 
 /**
  * Returns 8 hex digits of 32 bit input with leading 0x
- * Calls hex32 function for conversion of 32 bit input
- * 
+ *
  * @param i: 32 bits to be strung as hex
  *
  * @return: string of 0x and 8 hex digits
  **/
 string hex0x32(uint32_t i)
 {
-	return string("0x") + hex32(i);
+	char buf[hex0x32_len];
+	return string(buf, hex0x32(buf, i));
 }
@@ -12,8 +12,19 @@
 #include <string>
 #include <stdint.h>
 
+//Characters written by the buffer versions below
+static constexpr int hex8_len = 2;
+static constexpr int hex16_len = 4;
+static constexpr int hex32_len = 8;
+static constexpr int hex0x32_len = 10;
+
+char* hex8(char* buf, uint8_t i);
+char* hex16(char* buf, uint16_t i);
+char* hex32(char* buf, uint32_t i);
+char* hex0x32(char* buf, uint32_t i);
+
 std::string hex8(uint8_t i);
 std::string hex32(uint32_t i);
 std::string hex0x32(uint32_t i);
 
-#endif
\ No newline at end of file
+#endif
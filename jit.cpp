@@ -0,0 +1,611 @@
+//*****************************************************************************
+//
+//  jit.cpp
+//  CSCI 463 Assignment 5
+//
+//  Created by Daniel Widing (z1838064)
+//
+//*****************************************************************************
+#include <cstring>
+
+#include "jit.h"
+#include "rv32i.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JIT_X64
+#endif
+
+//Host registers used by compiled code, by their x86 register number
+static constexpr uint8_t host_eax = 0;
+static constexpr uint8_t host_ecx = 1;
+static constexpr uint8_t host_edx = 2;
+
+//Condition codes, added to 0x0f 0x40 for cmovcc and 0x0f 0x90 for setcc
+static constexpr uint8_t cc_b  = 0x2;
+static constexpr uint8_t cc_ae = 0x3;
+static constexpr uint8_t cc_e  = 0x4;
+static constexpr uint8_t cc_ne = 0x5;
+static constexpr uint8_t cc_a  = 0x7;
+static constexpr uint8_t cc_l  = 0xc;
+static constexpr uint8_t cc_ge = 0xd;
+static constexpr uint8_t cc_g  = 0xf;
+
+//Memory accesses are made through these so compiled code sees the same
+//range checks and code write tracking as the interpreter
+static uint32_t jit_lb(memory* m, uint32_t addr) { return (int8_t)m->get8(addr); }
+static uint32_t jit_lh(memory* m, uint32_t addr) { return (int16_t)m->get16(addr); }
+static uint32_t jit_lw(memory* m, uint32_t addr) { return m->get32(addr); }
+static uint32_t jit_lbu(memory* m, uint32_t addr) { return m->get8(addr); }
+static uint32_t jit_lhu(memory* m, uint32_t addr) { return m->get16(addr); }
+static void jit_sb(memory* m, uint32_t addr, uint32_t val) { m->set8(addr, val); }
+static void jit_sh(memory* m, uint32_t addr, uint32_t val) { m->set16(addr, val); }
+static void jit_sw(memory* m, uint32_t addr, uint32_t val) { m->set32(addr, val); }
+
+//Multiply and divide forms that are more than an x86 instruction or two are
+//called the same way, with the memory argument unused
+static uint32_t jit_mulhsu(memory*, uint32_t a, uint32_t b) { return mulhsu32(a, b); }
+static uint32_t jit_div(memory*, uint32_t a, uint32_t b) { return div32(a, b); }
+static uint32_t jit_divu(memory*, uint32_t a, uint32_t b) { return divu32(a, b); }
+static uint32_t jit_rem(memory*, uint32_t a, uint32_t b) { return rem32(a, b); }
+static uint32_t jit_remu(memory*, uint32_t a, uint32_t b) { return remu32(a, b); }
+
+//Bit counts are called too, since lzcnt, tzcnt and popcnt can not be emitted
+//without first asking the host CPU whether it has them
+static uint32_t jit_clz(memory*, uint32_t a) { return clz32(a); }
+static uint32_t jit_ctz(memory*, uint32_t a) { return ctz32(a); }
+static uint32_t jit_cpop(memory*, uint32_t a) { return cpop32(a); }
+static uint32_t jit_orc_b(memory*, uint32_t a) { return orc_b32(a); }
+
+/**
+ * Constructs a compiler with no executable memory yet
+ **/
+jit::jit() : code(nullptr), used(0), failed(false)
+{
+}
+
+/**
+ * Frees the executable memory
+ **/
+jit::~jit()
+{
+	if (code != nullptr)
+	{
+#if defined(_WIN32)
+		VirtualFree(code, 0, MEM_RELEASE);
+#else
+		munmap(code, code_capacity);
+#endif
+	}
+}
+
+/**
+ * Throws away all compiled code so its space can be reused
+ **/
+void jit::reset()
+{
+	used = 0;
+}
+
+/**
+ * Compiles a basic block into a native function
+ *
+ * The function takes a jit_context, runs every instruction of the block,
+ * sets retired and returns the address to continue at. If a store writes
+ * over code it returns early, right after the store.
+ *
+ * @param b: block to compile
+ *
+ * @return: the compiled block, or nullptr if the block has an instruction
+ *          that must be interpreted, the code buffer is full or the host is
+ *          not x86-64
+ **/
+jit_fn jit::compile(const basic_block* b)
+{
+#ifndef JIT_X64
+	return nullptr;
+#else
+	if (failed)
+	{
+		return nullptr;
+	}
+
+	//Gets the executable buffer the first time anything is compiled
+	if (code == nullptr)
+	{
+#if defined(_WIN32)
+		void* p = VirtualAlloc(nullptr, code_capacity, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+		void* p = mmap(nullptr, code_capacity, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED)
+		{
+			p = nullptr;
+		}
+#endif
+		if (p == nullptr)
+		{
+			failed = true;
+			return nullptr;
+		}
+		code = static_cast<uint8_t*>(p);
+	}
+
+	buf.clear();
+
+	//push rbx, r12, r13 and reserve the Win64 shadow space, which also
+	//leaves the stack 16 byte aligned for calls
+	emit8(0x53);
+	emit8(0x41); emit8(0x54);
+	emit8(0x41); emit8(0x55);
+	emit8(0x48); emit8(0x83); emit8(0xec); emit8(0x20);
+
+	//r13 = ctx, rbx = ctx->regs, r12 = ctx->mem
+#if defined(_WIN32)
+	emit8(0x49); emit8(0x89); emit8(0xcd);
+#else
+	emit8(0x49); emit8(0x89); emit8(0xfd);
+#endif
+	emit8(0x49); emit8(0x8b); emit8(0x5d); emit8(offsetof(jit_context, regs));
+	emit8(0x4d); emit8(0x8b); emit8(0x65); emit8(offsetof(jit_context, mem));
+
+	uint32_t addr = b->start;
+	for (uint32_t i = 0; i < b->count; i++)
+	{
+		if (!emit_insn(b->ops[i], addr, i))
+		{
+			return nullptr;
+		}
+		addr += b->ops[i].len;
+	}
+
+	//A block cut short falls through to the next address
+	switch (b->ops[b->count - 1].op)
+	{
+	case op_jal:
+	case op_jalr:
+	case op_beq:
+	case op_bne:
+	case op_blt:
+	case op_bge:
+	case op_bltu:
+	case op_bgeu:
+		break;
+	default:
+		emit8(0xb8); emit32(b->end);
+		emit_exit(b->count);
+		break;
+	}
+
+	if (used + buf.size() > code_capacity)
+	{
+		return nullptr;
+	}
+
+	memcpy(code + used, buf.data(), buf.size());
+	jit_fn fn = reinterpret_cast<jit_fn>(code + used);
+	used = (used + buf.size() + 15) & ~static_cast<size_t>(15);
+
+	return fn;
+#endif
+}
+
+/**
+ * Appends a byte of code
+ *
+ * @param b: byte to append
+ **/
+void jit::emit8(uint8_t b)
+{
+	buf.push_back(b);
+}
+
+/**
+ * Appends a little-endian 32 bit value
+ *
+ * @param v: value to append
+ **/
+void jit::emit32(uint32_t v)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		emit8(v >> (8 * i));
+	}
+}
+
+/**
+ * Appends a little-endian 64 bit value
+ *
+ * @param v: value to append
+ **/
+void jit::emit64(uint64_t v)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		emit8(v >> (8 * i));
+	}
+}
+
+/**
+ * Appends an instruction whose memory operand is a guest register, as
+ * [rbx + 4*r]
+ *
+ * @param opcode: x86 opcode byte
+ * @param   host: host register (or opcode extension) of the ModRM reg field
+ * @param      r: guest register number
+ **/
+void jit::emit_reg(uint8_t opcode, uint8_t host, uint32_t r)
+{
+	emit8(opcode);
+	emit8(0x43 | (host << 3));
+	emit8(4 * r);
+}
+
+/**
+ * Appends setcc al, movzx eax, al and stores eax to guest register rd
+ *
+ * @param cc: condition code to set on
+ * @param rd: guest register to write, nothing is written for x0
+ **/
+void jit::emit_setcc(uint8_t cc, uint32_t rd)
+{
+	emit8(0x0f); emit8(0x90 + cc); emit8(0xc0);
+	emit8(0x0f); emit8(0xb6); emit8(0xc0);
+
+	if (rd != 0)
+	{
+		emit_reg(0x89, host_eax, rd);
+	}
+}
+
+/**
+ * Appends a call to a memory helper with memory in the first argument, eax
+ * in the second and ecx in the third
+ *
+ * @param fn: function to call
+ **/
+void jit::emit_call(const void* fn)
+{
+#if defined(_WIN32)
+	emit8(0x41); emit8(0x89); emit8(0xc8);     //mov r8d, ecx
+	emit8(0x89); emit8(0xc2);                  //mov edx, eax
+	emit8(0x4c); emit8(0x89); emit8(0xe1);     //mov rcx, r12
+#else
+	emit8(0x89); emit8(0xca);                  //mov edx, ecx
+	emit8(0x89); emit8(0xc6);                  //mov esi, eax
+	emit8(0x4c); emit8(0x89); emit8(0xe7);     //mov rdi, r12
+#endif
+	emit8(0x48); emit8(0xb8); emit64(reinterpret_cast<uintptr_t>(fn));
+	emit8(0xff); emit8(0xd0);
+}
+
+/**
+ * Appends the return from a compiled block, with the next pc already in eax
+ *
+ * @param retired: instructions run when returning from here
+ **/
+void jit::emit_exit(uint32_t retired)
+{
+	emit8(0x41); emit8(0xc7); emit8(0x45); emit8(offsetof(jit_context, retired)); emit32(retired);
+	emit8(0x48); emit8(0x83); emit8(0xc4); emit8(0x20);
+	emit8(0x41); emit8(0x5d);
+	emit8(0x41); emit8(0x5c);
+	emit8(0x5b);
+	emit8(0xc3);
+}
+
+/**
+ * Appends the native code for one instruction of a block
+ *
+ * @param     d: decoded instruction
+ * @param  addr: address of the instruction
+ * @param index: position of the instruction in its block
+ *
+ * @return: false if the instruction can not be compiled
+ **/
+bool jit::emit_insn(const decoded_insn& d, uint32_t addr, uint32_t index)
+{
+	const void* helper = nullptr;
+	uint8_t cc = 0;
+	uint8_t alu = 0;
+	uint8_t shift = 0;
+
+	switch (d.op)
+	{
+	default:
+		return false;
+
+	case op_lui:
+	case op_auipc:
+		if (d.rd != 0)
+		{
+			emit_reg(0xc7, 0, d.rd);
+			emit32(d.op == op_lui ? d.imm : addr + d.imm);
+		}
+		return true;
+
+	case op_jal:
+		if (d.rd != 0)
+		{
+			emit_reg(0xc7, 0, d.rd);
+			emit32(addr + d.len);
+		}
+		emit8(0xb8); emit32(addr + d.imm);
+		emit_exit(index + 1);
+		return true;
+
+	case op_jalr:
+		//Target is computed before rd is written, as rd may be rs1
+		emit_reg(0x8b, host_eax, d.rs1);
+		emit8(0x05); emit32(d.imm);
+		emit8(0x25); emit32(0xfffffffe);
+		if (d.rd != 0)
+		{
+			emit_reg(0xc7, 0, d.rd);
+			emit32(addr + d.len);
+		}
+		emit_exit(index + 1);
+		return true;
+
+	case op_beq:  cc = cc_e;  goto branch;
+	case op_bne:  cc = cc_ne; goto branch;
+	case op_blt:  cc = cc_l;  goto branch;
+	case op_bge:  cc = cc_ge; goto branch;
+	case op_bltu: cc = cc_b;  goto branch;
+	case op_bgeu: cc = cc_ae; goto branch;
+	branch:
+		//eax = fall through, ecx = target, cmov picks the target if taken
+		emit_reg(0x8b, host_eax, d.rs1);
+		emit_reg(0x3b, host_eax, d.rs2);
+		emit8(0xb8); emit32(addr + d.len);
+		emit8(0xb9); emit32(addr + d.imm);
+		emit8(0x0f); emit8(0x40 + cc); emit8(0xc1);
+		emit_exit(index + 1);
+		return true;
+
+	case op_lb:  helper = reinterpret_cast<const void*>(&jit_lb);  goto load;
+	case op_lh:  helper = reinterpret_cast<const void*>(&jit_lh);  goto load;
+	case op_lw:  helper = reinterpret_cast<const void*>(&jit_lw);  goto load;
+	case op_lbu: helper = reinterpret_cast<const void*>(&jit_lbu); goto load;
+	case op_lhu: helper = reinterpret_cast<const void*>(&jit_lhu); goto load;
+	load:
+		//Still loads into x0 for the out of range warning
+		emit_reg(0x8b, host_eax, d.rs1);
+		emit8(0x05); emit32(d.imm);
+		emit_call(helper);
+		if (d.rd != 0)
+		{
+			emit_reg(0x89, host_eax, d.rd);
+		}
+		return true;
+
+	case op_sb: helper = reinterpret_cast<const void*>(&jit_sb); goto store;
+	case op_sh: helper = reinterpret_cast<const void*>(&jit_sh); goto store;
+	case op_sw: helper = reinterpret_cast<const void*>(&jit_sw); goto store;
+	store:
+	{
+		emit_reg(0x8b, host_ecx, d.rs2);
+		emit_reg(0x8b, host_eax, d.rs1);
+		emit8(0x05); emit32(d.imm);
+		emit_call(helper);
+
+		//Leaves right after the store if it wrote over code
+		emit8(0x49); emit8(0x8b); emit8(0x45); emit8(offsetof(jit_context, stale));
+		emit8(0x80); emit8(0x38); emit8(0x00);
+		emit8(0x0f); emit8(0x84);
+		size_t patch = buf.size();
+		emit32(0);
+		emit8(0xb8); emit32(addr + d.len);
+		emit_exit(index + 1);
+
+		uint32_t skip = buf.size() - (patch + 4);
+		memcpy(&buf[patch], &skip, 4);
+		return true;
+	}
+
+	case op_slti:  cc = cc_l; goto compare_imm;
+	case op_sltiu: cc = cc_b; goto compare_imm;
+	compare_imm:
+		emit_reg(0x8b, host_eax, d.rs1);
+		emit8(0x3d); emit32(d.imm);
+		emit_setcc(cc, d.rd);
+		return true;
+
+	case op_slt:  cc = cc_l; goto compare;
+	case op_sltu: cc = cc_b; goto compare;
+	compare:
+		emit_reg(0x8b, host_eax, d.rs1);
+		emit_reg(0x3b, host_eax, d.rs2);
+		emit_setcc(cc, d.rd);
+		return true;
+
+	case op_addi: alu = 0x05; goto alu_imm;
+	case op_xori: alu = 0x35; goto alu_imm;
+	case op_ori:  alu = 0x0d; goto alu_imm;
+	case op_andi: alu = 0x25; goto alu_imm;
+	alu_imm:
+		if (d.rd != 0)
+		{
+			emit_reg(0x8b, host_eax, d.rs1);
+			emit8(alu); emit32(d.imm);
+			emit_reg(0x89, host_eax, d.rd);
+		}
+		return true;
+
+	case op_add: alu = 0x03; goto alu_reg;
+	case op_sub: alu = 0x2b; goto alu_reg;
+	case op_xor: alu = 0x33; goto alu_reg;
+	case op_or:  alu = 0x0b; goto alu_reg;
+	case op_and: alu = 0x23; goto alu_reg;
+	alu_reg:
+		if (d.rd != 0)
+		{
+			emit_reg(0x8b, host_eax, d.rs1);
+			emit_reg(alu, host_eax, d.rs2);
+			emit_reg(0x89, host_eax, d.rd);
+		}
+		return true;
+
+	case op_slli: shift = 0xe0; goto shift_imm;
+	case op_srli: shift = 0xe8; goto shift_imm;
+	case op_srai: shift = 0xf8; goto shift_imm;
+	case op_rori: shift = 0xc8; goto shift_imm;
+	shift_imm:
+		if (d.rd != 0)
+		{
+			emit_reg(0x8b, host_eax, d.rs1);
+			emit8(0xc1); emit8(shift); emit8(d.imm & 0x1f);
+			emit_reg(0x89, host_eax, d.rd);
+		}
+		return true;
+
+	case op_sll: shift = 0xe0; goto shift_reg;
+	case op_srl: shift = 0xe8; goto shift_reg;
+	case op_sra: shift = 0xf8; goto shift_reg;
+	case op_rol: shift = 0xc0; goto shift_reg;
+	case op_ror: shift = 0xc8; goto shift_reg;
+	shift_reg:
+		//x86 masks the count in cl to 5 bits, just like RV32I
+		if (d.rd != 0)
+		{
+			emit_reg(0x8b, host_ecx, d.rs2);
+			emit_reg(0x8b, host_eax, d.rs1);
+			emit8(0xd3); emit8(shift);
+			emit_reg(0x89, host_eax, d.rd);
+		}
+		return true;
+
+	case op_mul:
+		if (d.rd != 0)
+		{
+			emit_reg(0x8b, host_eax, d.rs1);
+			emit8(0x0f); emit_reg(0xaf, host_eax, d.rs2);
+			emit_reg(0x89, host_eax, d.rd);
+		}
+		return true;
+
+	case op_mulh:  alu = 5; goto mul_high;
+	case op_mulhu: alu = 4; goto mul_high;
+	mul_high:
+		//One operand imul or mul leaves the high half in edx
+		if (d.rd != 0)
+		{
+			emit_reg(0x8b, host_eax, d.rs1);
+			emit_reg(0xf7, alu, d.rs2);
+			emit_reg(0x89, host_edx, d.rd);
+		}
+		return true;
+
+	case op_mulhsu: helper = reinterpret_cast<const void*>(&jit_mulhsu); goto muldiv_call;
+	case op_div:    helper = reinterpret_cast<const void*>(&jit_div);    goto muldiv_call;
+	case op_divu:   helper = reinterpret_cast<const void*>(&jit_divu);   goto muldiv_call;
+	case op_rem:    helper = reinterpret_cast<const void*>(&jit_rem);    goto muldiv_call;
+	case op_remu:   helper = reinterpret_cast<const void*>(&jit_remu);   goto muldiv_call;
+	muldiv_call:
+		//Called rather than inlined so a zero divisor or overflow can not
+		//raise a host exception
+		if (d.rd != 0)
+		{
+			emit_reg(0x8b, host_ecx, d.rs2);
+			emit_reg(0x8b, host_eax, d.rs1);
+			emit_call(helper);
+			emit_reg(0x89, host_eax, d.rd);
+		}
+		return true;
+
+	case op_sh1add: shift = 1; goto shift_add;
+	case op_sh2add: shift = 2; goto shift_add;
+	case op_sh3add: shift = 3; goto shift_add;
+	shift_add:
+		if (d.rd != 0)
+		{
+			emit_reg(0x8b, host_eax, d.rs1);
+			emit8(0xc1); emit8(0xe0); emit8(shift);
+			emit_reg(0x03, host_eax, d.rs2);
+			emit_reg(0x89, host_eax, d.rd);
+		}
+		return true;
+
+	case op_andn: alu = 0x23; goto alu_not;
+	case op_orn:  alu = 0x0b; goto alu_not;
+	alu_not:
+		//not rs2, then and or or rs1 into it
+		if (d.rd != 0)
+		{
+			emit_reg(0x8b, host_eax, d.rs2);
+			emit8(0xf7); emit8(0xd0);
+			emit_reg(alu, host_eax, d.rs1);
+			emit_reg(0x89, host_eax, d.rd);
+		}
+		return true;
+
+	case op_xnor:
+		if (d.rd != 0)
+		{
+			emit_reg(0x8b, host_eax, d.rs1);
+			emit_reg(0x33, host_eax, d.rs2);
+			emit8(0xf7); emit8(0xd0);
+			emit_reg(0x89, host_eax, d.rd);
+		}
+		return true;
+
+	case op_min:  cc = cc_g; goto min_max;
+	case op_minu: cc = cc_a; goto min_max;
+	case op_max:  cc = cc_l; goto min_max;
+	case op_maxu: cc = cc_b; goto min_max;
+	min_max:
+		//eax = rs1, cmov picks rs2 in ecx if it is the one wanted
+		if (d.rd != 0)
+		{
+			emit_reg(0x8b, host_eax, d.rs1);
+			emit_reg(0x8b, host_ecx, d.rs2);
+			emit8(0x39); emit8(0xc8);
+			emit8(0x0f); emit8(0x40 + cc); emit8(0xc1);
+			emit_reg(0x89, host_eax, d.rd);
+		}
+		return true;
+
+	case op_sext_b: alu = 0xbe; goto extend;
+	case op_sext_h: alu = 0xbf; goto extend;
+	case op_zext_h: alu = 0xb7; goto extend;
+	extend:
+		//movsx or movzx from the low byte or half of rs1
+		if (d.rd != 0)
+		{
+			emit8(0x0f); emit_reg(alu, host_eax, d.rs1);
+			emit_reg(0x89, host_eax, d.rd);
+		}
+		return true;
+
+	case op_rev8:
+		if (d.rd != 0)
+		{
+			emit_reg(0x8b, host_eax, d.rs1);
+			emit8(0x0f); emit8(0xc8);
+			emit_reg(0x89, host_eax, d.rd);
+		}
+		return true;
+
+	case op_clz:   helper = reinterpret_cast<const void*>(&jit_clz);   goto unary_call;
+	case op_ctz:   helper = reinterpret_cast<const void*>(&jit_ctz);   goto unary_call;
+	case op_cpop:  helper = reinterpret_cast<const void*>(&jit_cpop);  goto unary_call;
+	case op_orc_b: helper = reinterpret_cast<const void*>(&jit_orc_b); goto unary_call;
+	unary_call:
+		if (d.rd != 0)
+		{
+			emit_reg(0x8b, host_eax, d.rs1);
+			emit_call(helper);
+			emit_reg(0x89, host_eax, d.rd);
+		}
+		return true;
+
+	case op_fence:
+		//mfence, ordering memory against other harts like the interpreter
+		emit8(0x0f); emit8(0xae); emit8(0xf0);
+		return true;
+	}
+}
@@ -0,0 +1,71 @@
+//*****************************************************************************
+//
+//  jit.h
+//  CSCI 463 Assignment 5
+//
+//  Created by Daniel Widing (z1838064)
+//
+//*****************************************************************************
+#ifndef jit_H
+#define jit_H
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "memory.h"
+
+struct basic_block;
+struct decoded_insn;
+
+/**
+ * Everything compiled code needs from the hart. It is passed to each
+ * compiled block, which fills in retired before returning the next pc.
+ **/
+struct jit_context
+{
+	int32_t* regs;                       //the hart's registers
+	memory* mem;                         //memory loads and stores go to
+	const std::atomic<bool>* stale;      //set when a store overwrites code
+	uint32_t retired;                    //instructions the block ran
+};
+
+typedef uint32_t (*jit_fn)(jit_context* ctx);
+
+/**
+ * Translates basic blocks of RV32I into native x86-64 code
+ *
+ * Guest registers stay in the context's register array and loads and stores
+ * call into memory, so compiled blocks behave exactly like the interpreter.
+ * On any other host, or if no executable memory can be had, compile always
+ * returns nullptr and everything stays interpreted.
+ **/
+class jit
+{
+public:
+	jit();
+	~jit();
+
+	jit_fn compile(const basic_block* b);
+	void reset();
+
+private:
+	static constexpr size_t code_capacity = 16 * 1024 * 1024;
+
+	uint8_t* code;                //executable buffer, allocated on first compile
+	size_t used;                  //bytes of code holding compiled blocks
+	bool failed;                  //no executable memory could be allocated
+	std::vector<uint8_t> buf;     //block being assembled
+
+	void emit8(uint8_t b);
+	void emit32(uint32_t v);
+	void emit64(uint64_t v);
+	void emit_reg(uint8_t opcode, uint8_t host, uint32_t r);
+	void emit_setcc(uint8_t cc, uint32_t rd);
+	void emit_call(const void* fn);
+	void emit_exit(uint32_t retired);
+	bool emit_insn(const decoded_insn& d, uint32_t addr, uint32_t index);
+};
+
+#endif
@@ -11,6 +11,7 @@
 #include <cstdlib>
 #include <cmath>
 #include <string>
+#include <vector>
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -20,20 +21,36 @@
 #include "memory.h"
 #include "rv32i.h"
 #include "registerfile.h"
+#include "syscalls.h"
 
 using namespace std;
 
+//Each hart after the first starts with its stack this far below the last one's
+static constexpr uint32_t hart_stack_size = 0x10000;
+
 /**
 * Print a usage message and abort the program.
 *********************************************************************/
 static void usage()
 {
-	cerr << "Usage: [-d] [-i] [-l execution-limit] [-m hex-mem-size] [-r] [-z] infile" << endl;
+	cerr << "Usage: [-a] [-c] [-C checkpoint-file] [-d] [-e] [-H harts] [-i] [-l execution-limit] [-m hex-mem-size] [-n] [-p] [-r] [-s hex-stack-top] [-t trace-file] [-z] infile" << endl;
+	cerr << "       [-R checkpoint-file] [-T trace-file]" << endl;
+	cerr << "    -a print -i instructions from a second thread" << endl;
+	cerr << "    -c compress -d and -z output, leaving out untouched memory and repeated lines" << endl;
+	cerr << "    -C save the hart and memory to a checkpoint file after simulation has stopped" << endl;
 	cerr << "    -d show disassembly before program simulation" << endl;
+	cerr << "    -e make Linux system calls on ecall, on host files, instead of halting" << endl;
+	cerr << "    -H run this many harts over one memory, each on its own thread, with stacks 64k apart" << endl;
 	cerr << "    -i show instruction printing during execution" << endl;
 	cerr << "    -l execution-limit" << endl;
 	cerr << "    -m specify memory size (default = 0x10000)" << endl;
+	cerr << "    -n never compile hot code to native instructions" << endl;
+	cerr << "    -p allocate memory a page at a time as it is first written" << endl;
 	cerr << "    -r show dump of hart status before each instruction" << endl;
+	cerr << "    -R carry on from a checkpoint saved with -C instead of loading infile" << endl;
+	cerr << "    -s specify initial stack pointer (default = memory size)" << endl;
+	cerr << "    -t record a compact binary trace of every instruction executed" << endl;
+	cerr << "    -T print a binary trace recorded with -t as -i would have" << endl;
 	cerr << "    -z show dump of hart status and memory after simulation has halted" << endl;
 	exit(1);
 }
@@ -43,23 +60,50 @@ static void usage()
 ********************************************************************/
 int main(int argc, char** argv)
 {
+	bool async_trace = false;
+	bool compress_output = false;
 	bool show_disassembly = false;
+	bool emulate_syscalls = false;
 	bool show_instruction_printing = false; 
 	uint64_t instruction_limit = 0;
 	bool instruction_limit_set = false;
 	uint32_t memory_limit = 0x10000;		         //default memory size = 64k
 	bool repeat_hart_dump = false;
 	bool end_hart_memory_dump = false;
+	bool no_jit = false;
+	bool paged_memory = false;
+	uint32_t stack_top = 0;
+	bool stack_top_set = false;
+	const char* record_trace = nullptr;
+	const char* render_trace = nullptr;
+	const char* save_checkpoint = nullptr;
+	const char* restore_checkpoint = nullptr;
+	uint32_t hart_count = 1;
 
 	int opt;
 
-	while ((opt = getopt(argc, argv, "dil:m:rz")) != -1)
+	while ((opt = getopt(argc, argv, "acC:deH:il:m:nprR:s:t:T:z")) != -1)
 	{
 		switch (opt)
 		{
+		case 'a':
+			async_trace = true;
+			break;
+		case 'c':
+			compress_output = true;
+			break;
+		case 'C':
+			save_checkpoint = optarg;
+			break;
 		case 'd':
 			show_disassembly = true;
 			break;
+		case 'e':
+			emulate_syscalls = true;
+			break;
+		case 'H':
+			hart_count = std::stoul(optarg, nullptr, 10);
+			break;
 		case 'i':
 			show_instruction_printing = true;
 			break;
@@ -70,9 +114,28 @@ int main(int argc, char** argv)
 		case 'm':
 			memory_limit = std::stoul(optarg, nullptr, 16);
 			break;
+		case 'n':
+			no_jit = true;
+			break;
+		case 'p':
+			paged_memory = true;
+			break;
 		case 'r':
 			repeat_hart_dump = true;
 			break;
+		case 'R':
+			restore_checkpoint = optarg;
+			break;
+		case 's':
+			stack_top = std::stoul(optarg, nullptr, 16);
+			stack_top_set = true;
+			break;
+		case 't':
+			record_trace = optarg;
+			break;
+		case 'T':
+			render_trace = optarg;
+			break;
 		case 'z':
 			end_hart_memory_dump = true;
 			break;
@@ -81,13 +144,50 @@ int main(int argc, char** argv)
 		}
 	}
 
-	if (optind >= argc)
+	//Prints a recorded trace instead of running anything
+	if (render_trace)
+	{
+		trace_reader reader;
+		if (!reader.open(render_trace))
+			usage();
+
+		memory replay_mem(reader.get_mem_size(), true);
+		rv32i replay_sim(&replay_mem);
+		replay_sim.replay(reader);
+		return 0;
+	}
+
+	if (optind >= argc && !restore_checkpoint)
 		usage();	// missing filename
 
-	memory mem(memory_limit);
+	//Harts running together can not take turns printing, and share memory
+	//that must not move under them
+	if (hart_count == 0)
+		usage();
+	if (hart_count > 1 && (async_trace || save_checkpoint || show_instruction_printing || paged_memory || repeat_hart_dump || restore_checkpoint || record_trace))
+	{
+		cerr << "-H can not be used with -a, -C, -i, -p, -r, -R or -t." << endl;
+		usage();
+	}
 
-	if (!mem.load_file(argv[optind]))
+	//Guest output goes through cout, which the -a writer thread owns
+	if (emulate_syscalls && async_trace)
+	{
+		cerr << "-e can not be used with -a." << endl;
 		usage();
+	}
+
+	memory mem(memory_limit, paged_memory);
+
+	if (!restore_checkpoint && !mem.load_file(argv[optind]))
+		usage();
+
+	//Every hart's stack must fit below the stack top
+	if (hart_count > 1 && static_cast<uint64_t>(hart_count) * hart_stack_size > (stack_top_set ? stack_top : mem.get_size()))
+	{
+		cerr << "Not enough memory below the stack top for " << hart_count << " hart stacks of 64k." << endl;
+		usage();
+	}
 
 	//allinsns5 test file
 	//memory mem(0x100);
@@ -109,14 +209,26 @@ int main(int argc, char** argv)
 	//mem.load_file("sieve.bin");
 	//end_hart_memory_dump = true;
 
+	//lrsc5 test file, run as -e -H 2 -m 20000 lrsc5.bin: hart 1 stores a
+	//new value and then the old one back to the word hart 0 has reserved
+	//with lr.w, so hart 0's sc.w must fail, and a second lr.w/sc.w with
+	//nothing in between must succeed. It exits 0 if both did.
+	//memory mem(0x20000);
+	//mem.load_file("lrsc5.bin");
+	//emulate_syscalls = true;
+	//hart_count = 2;
+
 	//Creates rv32i object
 	rv32i sim(&mem);
+
+	//Conditional start from a checkpoint, memory size and all
+	if (restore_checkpoint && !sim.load_checkpoint(restore_checkpoint))
+		usage();
 	
 	//Conditional show disassembly before simulation start
 	if (show_disassembly)
 	{
-		sim.disasm();
-		sim.reset();
+		sim.disasm(compress_output);
 	}
 
 	//Conditional show instructions while simulating
@@ -125,6 +237,12 @@ int main(int argc, char** argv)
 		sim.set_show_instructions(true);
 	}
 
+	//Conditional instruction printing on a second thread
+	if (async_trace)
+	{
+		sim.set_async_trace(true);
+	}
+
 	//Conditional dump hart while simulating
 	if (repeat_hart_dump)
 	{
@@ -137,15 +255,85 @@ int main(int argc, char** argv)
 		sim.set_has_insn_limit(true);
 	}
 
+	//Conditional stack pointer other than the top of memory
+	if (stack_top_set)
+	{
+		sim.set_stack_top(stack_top);
+	}
+
+	//Conditional binary trace
+	trace_writer writer;
+	if (record_trace)
+	{
+		if (!writer.open(record_trace))
+			usage();
+		sim.set_trace_writer(&writer);
+	}
+
+	//Conditional interpreting only
+	if (no_jit)
+	{
+		sim.set_use_jit(false);
+	}
+
+	//Conditional system calls, one emulator for every hart
+	syscalls sys(&mem);
+	if (emulate_syscalls)
+	{
+		sim.set_syscalls(&sys);
+	}
+
+	//Conditional more harts, each with its own id and stack
+	if (hart_count > 1)
+	{
+		uint32_t top = stack_top_set ? stack_top : mem.get_size();
+		vector<rv32i*> harts;
+		harts.push_back(&sim);
+		for (uint32_t i = 1; i < hart_count; i++)
+		{
+			rv32i* hart = new rv32i(&mem);
+			hart->set_hart_id(i);
+			hart->set_stack_top(top - i * hart_stack_size);
+			hart->set_has_insn_limit(instruction_limit_set);
+			hart->set_use_jit(!no_jit);
+			hart->set_syscalls(emulate_syscalls ? &sys : nullptr);
+			harts.push_back(hart);
+		}
+
+		//Runs simulation
+		rv32i::run_harts(harts, instruction_limit);
+
+		//Conditional dump of every hart, in order, after simulation
+		if (end_hart_memory_dump)
+		{
+			for (rv32i* hart : harts)
+			{
+				hart->dump();
+			}
+			mem.dump(compress_output);
+		}
+
+		for (uint32_t i = 1; i < hart_count; i++)
+		{
+			delete harts[i];
+		}
+		return sim.has_exited() ? sim.get_exit_status() : 0;
+	}
+
 	//Runs simulation
 	sim.run(instruction_limit);
 
+	//Conditional checkpoint of where simulation stopped
+	if (save_checkpoint && !sim.save_checkpoint(save_checkpoint))
+		return 1;
+
 	//Conditional dump hart after simulation
 	if (end_hart_memory_dump)
 	{
 		sim.dump();
-		mem.dump();
+		mem.dump(compress_output);
 	}
 	
-	return 0;
+	//A program that called exit gives its status back
+	return sim.has_exited() ? sim.get_exit_status() : 0;
 }
@@ -13,19 +13,118 @@
 #include <string>
 #include <fstream>
 #include <cstring>
+#include <atomic>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #include "hex.h"
 #include "memory.h"
 
 using namespace std;
 
+//Little-endian fields of ELF headers
+static uint16_t le16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+static uint32_t le32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+
+//Bits of a page's watched byte: what must hear about writes to it
+static constexpr uint8_t watched_code     = 1;    //holds code decoded by a code observer
+static constexpr uint8_t watched_reserved = 2;    //holds a word some hart's lr.w reserved
+
+//Checkpoint page records are a little-endian page number, then the page's
+//bytes unless the fill flag says it only holds 0xa5
+static constexpr uint32_t checkpoint_fill_page = 0x80000000;
+static constexpr uint32_t checkpoint_end = 0xffffffff;
+
+//Memory shared between harts on different threads is only read and written
+//through host atomics. Relaxed ones are plain moves on common hosts, so a
+//single hart pays nothing for them.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "aligned halfwords and words are read and written whole, so the host must be little-endian like the guest"
+#endif
+
+template <typename T>
+static std::atomic<T>& as_atomic(T& v)
+{
+	static_assert(sizeof(std::atomic<T>) == sizeof(T), "atomic must overlay the plain value");
+	return reinterpret_cast<std::atomic<T>&>(v);
+}
+
+template <typename T>
+static T load_relaxed(const uint8_t* p)
+{
+	return as_atomic(*reinterpret_cast<T*>(const_cast<uint8_t*>(p))).load(std::memory_order_relaxed);
+}
+
+template <typename T>
+static void store_relaxed(uint8_t* p, T v)
+{
+	as_atomic(*reinterpret_cast<T*>(p)).store(v, std::memory_order_relaxed);
+}
+
+static void put_le32(std::ostream& out, uint32_t v)
+{
+	char b[4] = { static_cast<char>(v), static_cast<char>(v >> 8), static_cast<char>(v >> 16), static_cast<char>(v >> 24) };
+	out.write(b, sizeof(b));
+}
+
+//The heap starts at the page after a loaded program, or at the end of memory
+static uint32_t heap_start(uint64_t end, uint32_t size)
+{
+	return static_cast<uint32_t>(min<uint64_t>((end + memory::page_size - 1) & ~static_cast<uint64_t>(memory::page_size - 1), size));
+}
+
 /**
  * Creates a new memory object by setting the size to the passed parameter and
- * allocating a new memory buffer of that size, filled with 0xa5
+ * allocating memory of that size, filled with 0xa5
+ *
+ * Flat memory is allocated all at once. Paged memory starts with every page
+ * sharing one page of 0xa5 and only gets a page of its own on the first
+ * write to it, so untouched memory costs nothing.
+ *
+ * @param   siz: size of memory buffer to allocate
+ * @param paged: allocate pages on first write instead of all up front
+ **/
+memory::memory(uint32_t siz, bool paged)
+{
+	quiet = false;
+	allocate(siz, paged);
+}
+
+/**
+ * Creates a new memory holding what a snapshot holds, sharing its pages
+ * until they are written, so many independent copies can carry on from one
+ * moment without each one copying the whole image
+ *
+ * @param     s: snapshot to start from
+ * @param paged: allocate pages on first write instead of all up front
+ **/
+memory::memory(const memory_snapshot& s, bool paged)
+{
+	quiet = false;
+	allocate(s.size, paged);
+	rollback(s);
+}
+
+/**
+ * Deallocates the memory buffer of the calling memory object
+ **/
+memory::~memory()
+{
+	release();
+}
+
+/**
+ * Sets up memory of the passed size with every byte 0xa5 and nothing
+ * loaded, written or watched
  *
- * @param siz: size of memory buffer to allocate
+ * @param   siz: size of memory buffer to allocate
+ * @param paged: allocate pages on first write instead of all up front
  **/
-memory::memory(uint32_t siz)
+void memory::allocate(uint32_t siz, bool paged)
 {
 	//Round memory size up to multiple of 16
 	siz = (siz + 15) & 0xfffffff0;
@@ -33,19 +132,273 @@ memory::memory(uint32_t siz)
 	//Sets member variable to parameter
 	size = siz;
 
-	//Allocates "size" memory to mem array
-	mem = new uint8_t[size];
+	//Pages covering memory, plus the byte at size that check_address lets
+	//through, so reads and writes there stay defined
+	uint32_t page_count = (size >> page_shift) + 1;
+
+	//Programs start at 0 unless loaded from an ELF file
+	entry = 0;
+	brk = 0;
+
+	//Nothing is mapped from a file until one is loaded
+	mapped = nullptr;
+	mapped_size = 0;
+
+	//Makes the page of 0xa5 that unwritten pages read from
+	fill = new uint8_t[page_size];
+	memset(fill, 0xa5, page_size);
+
+	if (paged)
+	{
+		flat = nullptr;
+		pages.assign(page_count, fill);
+	}
+	else
+	{
+		//Allocates every page in one buffer and sets every byte to 0xa5
+		flat = new uint8_t[page_count * static_cast<size_t>(page_size)];
+		memset(flat, 0xa5, page_count * static_cast<size_t>(page_size));
+
+		pages.resize(page_count);
+		for (uint32_t i = 0; i < page_count; i++)
+		{
+			pages[i] = flat + static_cast<size_t>(i) * page_size;
+		}
+	}
+
+	//No code is being watched yet, and no snapshot holds any page
+	watched.assign(page_count, 0);
+	reservations.clear();
+	shared.assign(page_count, nullptr);
 
-	//Sets every byte in memory array to 0xa5
-	memset(mem, 0xa5, size);
+	//Nothing has been loaded or written yet
+	touched.assign(page_count, 0);
+	dirty.assign((page_count + 63) / 64, 0);
 }
 
 /**
- * Deallocates the memory buffer of the calling memory object
+ * Frees every page, the file mapping and the fill page
  **/
-memory::~memory()
+void memory::release()
+{
+	for (uint32_t page = 0; page < pages.size(); page++)
+	{
+		free_page(page);
+	}
+
+	if (flat != nullptr)
+	{
+		delete[] flat;
+	}
+
+#if !defined(_WIN32)
+	if (mapped != nullptr)
+	{
+		munmap(mapped, mapped_size);
+	}
+#endif
+
+	delete[] fill;
+}
+
+/**
+ * Checks whether a page's bytes were allocated for it alone, rather than
+ * being the fill page, part of the flat buffer or file mapping, or held by
+ * a snapshot
+ *
+ * @param page: page number
+ *
+ * @return: whether the page must be deleted by this memory
+ **/
+bool memory::owns_page(uint32_t page) const
+{
+	const uint8_t* p = pages[page];
+	if (p == fill || shared[page])
+	{
+		return false;
+	}
+	if (flat != nullptr && p >= flat && p < flat + pages.size() * static_cast<size_t>(page_size))
+	{
+		return false;
+	}
+	return mapped == nullptr || p < mapped || p >= mapped + mapped_size;
+}
+
+/**
+ * Lets go of a page's bytes, deleting them if nothing else has them
+ *
+ * @param page: page number, which must be pointed somewhere else afterwards
+ **/
+void memory::free_page(uint32_t page)
+{
+	if (owns_page(page))
+	{
+		delete[] pages[page];
+	}
+	shared[page].reset();
+}
+
+/**
+ * Returns the page holding the passed address, giving it a page of its own
+ * first if it still shares the fill page or a snapshot's copy, and marks it
+ * touched and dirty
+ *
+ * @param addr: address about to be written, already range checked
+ *
+ * @return: the page's bytes
+ **/
+uint8_t* memory::writable_page(uint32_t addr)
+{
+	uint32_t page = addr >> page_shift;
+	mark_written(page);
+	return private_page(page);
+}
+
+/**
+ * Marks a page touched and dirty. Only the first write to a page since it
+ * was last clean marks it, so harts writing the same pages do not fight
+ * over the bitmap.
+ *
+ * @param page: page number
+ **/
+void memory::mark_written(uint32_t page)
+{
+	uint64_t bit = 1ull << (page & 63);
+	std::atomic<uint64_t>& word = as_atomic(dirty[page >> 6]);
+	if ((word.load(std::memory_order_relaxed) & bit) == 0)
+	{
+		as_atomic(touched[page]).store(1, std::memory_order_relaxed);
+		word.fetch_or(bit, std::memory_order_relaxed);
+	}
+}
+
+/**
+ * Gives a page bytes of its own if it still shares the fill page or a
+ * snapshot's copy
+ *
+ * @param page: page number
+ *
+ * @return: the page's bytes
+ **/
+uint8_t* memory::private_page(uint32_t page)
+{
+	uint8_t*& p = pages[page];
+	if (p == fill || shared[page])
+	{
+		uint8_t* copy = new uint8_t[page_size];
+		memcpy(copy, p, page_size);
+		p = copy;
+		shared[page].reset();
+	}
+
+	return p;
+}
+
+/**
+ * Finds how many bytes from the passed address lie one after another in the
+ * host, for copying straight to or from memory. Flat memory is one run up to
+ * the first page a snapshot has taken; paged memory is usually a page at a
+ * time, except where a file is mapped.
+ *
+ * @param addr: start of the bytes, already range checked
+ * @param  len: how many are wanted
+ *
+ * @return: how many of them, at least 1 if len is, are in one run
+ **/
+uint32_t memory::span_length(uint32_t addr, uint32_t len) const
+{
+	uint32_t page = addr >> page_shift;
+	uint32_t n = min(page_size - (addr & (page_size - 1)), len);
+	while (n < len && pages[page + 1] == pages[page] + page_size)
+	{
+		page++;
+		n += min(page_size, len - n);
+	}
+	return n;
+}
+
+/**
+ * Gives direct access to bytes of memory for a system call to copy out of
+ * in one go, such as by writing them to a host file
+ *
+ * @param addr: start of the bytes, the whole range already checked
+ * @param  len: how many are wanted, set to how many the pointer covers,
+ *              which may be fewer, so callers carry on from there
+ *
+ * @return: the first byte
+ **/
+const uint8_t* memory::read_span(uint32_t addr, uint32_t& len) const
+{
+	len = span_length(addr, len);
+	return pages[addr >> page_shift] + (addr & (page_size - 1));
+}
+
+/**
+ * Gives direct access to bytes of memory for a system call to copy into in
+ * one go, such as by reading a host file into them. Their pages get bytes of
+ * their own first, but are not marked written: span_written must be called
+ * with what was actually copied, so a short read does not mark pages it
+ * never reached.
+ *
+ * Pages a snapshot still shares are copied one at a time, so a span over
+ * them is a page long. Reservations on the span are broken up front, as
+ * the host may write any of it.
+ *
+ * @param addr: start of the bytes, the whole range already checked
+ * @param  len: how many are wanted, set to how many the pointer covers
+ *
+ * @return: the first byte
+ **/
+uint8_t* memory::write_span(uint32_t addr, uint32_t& len)
+{
+	uint32_t first = addr >> page_shift;
+	private_page(first);
+
+	//Takes in following pages that are already private and right after
+	uint32_t page = first;
+	uint32_t n = min(page_size - (addr & (page_size - 1)), len);
+	while (n < len && pages[page + 1] != fill && !shared[page + 1] && pages[page + 1] == pages[page] + page_size)
+	{
+		page++;
+		n += min(page_size, len - n);
+	}
+
+	len = n;
+	for (uint32_t p = first; p <= page; p++)
+	{
+		if (as_atomic(watched[p]).load(std::memory_order_relaxed) & watched_reserved)
+		{
+			break_reservations(addr, len);
+			break;
+		}
+	}
+	return pages[first] + (addr & (page_size - 1));
+}
+
+/**
+ * Marks bytes copied in through write_span as written, as set8 would have
+ * for each of them, and tells code observers about any watched pages among
+ * them
+ *
+ * @param addr: start of the bytes written
+ * @param  len: how many were written
+ **/
+void memory::span_written(uint32_t addr, uint32_t len)
 {
-	delete mem;
+	if (len == 0)
+	{
+		return;
+	}
+
+	uint32_t last = static_cast<uint32_t>((static_cast<uint64_t>(addr) + len - 1) >> page_shift);
+	for (uint32_t page = addr >> page_shift; page <= last; page++)
+	{
+		mark_written(page);
+		if (as_atomic(watched[page]).load(std::memory_order_relaxed) & watched_code)
+		{
+			code_written(page << page_shift);
+		}
+	}
 }
 
 /**
@@ -61,7 +414,10 @@ bool memory::check_address(uint32_t i) const
 	//Outputs error and returns false if address outside memory
 	if (i > size)
 	{
-		cout << "WARNING: Address out of range: " << hex0x32(i) << endl;
+		if (!quiet)
+		{
+			cout << "WARNING: Address out of range: " << hex0x32(i) << endl;
+		}
 		return false;
 	}
 
@@ -72,6 +428,17 @@ bool memory::check_address(uint32_t i) const
 	}
 }
 
+/**
+ * Sets quiet, which stops the out of range warnings of check_address while
+ * something else is printing them in its place
+ *
+ * @param b: what to set quiet to
+ **/
+void memory::set_quiet(bool b)
+{
+	quiet = b;
+}
+
 /**
  * Getter for size
  *
@@ -95,7 +462,7 @@ uint8_t memory::get8(uint32_t addr) const
 {
 	if (check_address(addr))
 	{
-		return mem[addr];
+		return load_relaxed<uint8_t>(pages[addr >> page_shift] + (addr & (page_size - 1)));
 	}
 
 	else
@@ -105,7 +472,44 @@ uint8_t memory::get8(uint32_t addr) const
 }
 
 /**
- * Calls get8() method twice to get combined 2 bytes at address
+ * Gets the value of the byte at passed address like get8(), but without the
+ * warning for an address not in memory
+ *
+ * @param addr: the address in calling memory of the data to return
+ *
+ * @return    0: if address not in memory
+ *		   data: returns data in memory if address in memory
+ **/
+uint8_t memory::peek8(uint32_t addr) const
+{
+	if (addr > size)
+	{
+		return 0;
+	}
+
+	return pages[addr >> page_shift][addr & (page_size - 1)];
+}
+
+/**
+ * Gets the combined 4 bytes at address like get32, but without warning about
+ * any out of range, which read as 0
+ *
+ * @param addr: the address in calling memory of the data to return
+ *
+ * @return: the data
+ **/
+uint32_t memory::peek32(uint32_t addr) const
+{
+	return peek8(addr) | (peek8(addr + 1) << 8) | (peek8(addr + 2) << 16) | (static_cast<uint32_t>(peek8(addr + 3)) << 24);
+}
+
+/**
+ * Gets the combined 2 bytes at address, least significant byte first.
+ * An aligned access is one range check and one load of the whole value, so
+ * harts sharing memory never see half of another's write. Any other access
+ * entirely in one page is still read in place. One that crosses a page or runs
+ * past the end is read a byte at a time with get8(), so each byte out of range
+ * warns and reads as 0.
  *
  * @param addr: the address in calling memory of the data to return
  *
@@ -114,6 +518,19 @@ uint8_t memory::get8(uint32_t addr) const
  **/
 uint16_t memory::get16(uint32_t addr) const
 {
+	//Fast path, an aligned value is read whole
+	if (addr < size && (addr & 1) == 0)
+	{
+		return load_relaxed<uint16_t>(pages[addr >> page_shift] + (addr & (page_size - 1)));
+	}
+
+	//Otherwise a byte at a time, still quickly if all in one page of memory
+	if (addr < size && size - addr >= 2 && (addr & (page_size - 1)) <= page_size - 2)
+	{
+		const uint8_t* p = pages[addr >> page_shift] + (addr & (page_size - 1));
+		return load_relaxed<uint8_t>(p) | (load_relaxed<uint8_t>(p + 1) << 8);
+	}
+
 	//Creates vars for both parts of the 2 byte value and the combined 2 byte value 
 	uint16_t combined = 0x0000;
 	uint8_t part1 = get8(addr);
@@ -128,7 +545,12 @@ uint16_t memory::get16(uint32_t addr) const
 }
 
 /**
- * Calls get16() method twice to get combined 4 bytes at address
+ * Gets the combined 4 bytes at address, least significant byte first.
+ * An aligned access is one range check and one load of the whole value, so
+ * harts sharing memory never see half of another's write. Any other access
+ * entirely in one page is still read in place. One that crosses a page or runs
+ * past the end is read a byte at a time with get8(), so each byte out of range
+ * warns and reads as 0.
  *
  * @param addr: the address in calling memory of the data to return
  *
@@ -137,6 +559,19 @@ uint16_t memory::get16(uint32_t addr) const
  **/
 uint32_t memory::get32(uint32_t addr) const
 {
+	//Fast path, an aligned value is read whole
+	if (addr < size && (addr & 3) == 0)
+	{
+		return load_relaxed<uint32_t>(pages[addr >> page_shift] + (addr & (page_size - 1)));
+	}
+
+	//Otherwise a byte at a time, still quickly if all in one page of memory
+	if (addr < size && size - addr >= 4 && (addr & (page_size - 1)) <= page_size - 4)
+	{
+		const uint8_t* p = pages[addr >> page_shift] + (addr & (page_size - 1));
+		return load_relaxed<uint8_t>(p) | (load_relaxed<uint8_t>(p + 1) << 8) | (load_relaxed<uint8_t>(p + 2) << 16) | (static_cast<uint32_t>(load_relaxed<uint8_t>(p + 3)) << 24);
+	}
+
 	//Creates vars for both parts of the 4 byte value and the combined 4 byte value 
 	uint32_t combined = 0x00000000;
 	uint16_t part1 = get16(addr);
@@ -161,19 +596,52 @@ void memory::set8(uint32_t addr, uint8_t val)
 {
 	if (check_address(addr))
 	{
-		mem[addr] = val;
+		//Lets decoded copies of this page, and reservations on it, know it changed
+		if (as_atomic(watched[addr >> page_shift]).load(std::memory_order_relaxed))
+		{
+			page_written(addr, 1);
+		}
+
+		store_relaxed<uint8_t>(writable_page(addr) + (addr & (page_size - 1)), val);
 	}
 }
 
 /**
- * Sets the value of the byte at passed address to the passed value.
- * Checks if passed address exists and does nothing if not.
+ * Sets the 2 bytes at passed address to the passed value, least significant
+ * byte first. An access entirely in one page of memory is one range check,
+ * and an aligned one is a single store of the whole value, so harts sharing
+ * memory never see half of it. One that crosses a page or runs past the end is
+ * written a byte at a time with set8(), so each byte out of range warns and is
+ * dropped.
  *
  * @param addr: the address in calling memory of the data to return
  * @param  val: the value to set the data in memory to
  **/
 void memory::set16(uint32_t addr, uint16_t val)
 {
+	//Fast path, the whole value is in one page of memory
+	if (addr < size && size - addr >= 2 && (addr & (page_size - 1)) <= page_size - 2)
+	{
+		//Lets decoded copies of this page, and reservations on it, know it changed
+		if (as_atomic(watched[addr >> page_shift]).load(std::memory_order_relaxed))
+		{
+			page_written(addr, 2);
+		}
+
+		//An aligned value is written whole
+		uint8_t* p = writable_page(addr) + (addr & (page_size - 1));
+		if ((addr & 1) == 0)
+		{
+			store_relaxed<uint16_t>(p, val);
+		}
+		else
+		{
+			store_relaxed<uint8_t>(p, val);
+			store_relaxed<uint8_t>(p + 1, val >> 8);
+		}
+		return;
+	}
+
 	//Gets the single byte parts of the 2 byte value
 	uint8_t part1 = (val >> 8) & 0xff;
 	uint8_t part2 = (val >> 0) & 0xff;
@@ -184,14 +652,43 @@ void memory::set16(uint32_t addr, uint16_t val)
 }
 
 /**
- * Sets the value of the byte at passed address to the passed value.
- * Checks if passed address exists and does nothing if not.
+ * Sets the 4 bytes at passed address to the passed value, least significant
+ * byte first. An access entirely in one page of memory is one range check,
+ * and an aligned one is a single store of the whole value, so harts sharing
+ * memory never see half of it. One that crosses a page or runs past the end is
+ * written a byte at a time with set8(), so each byte out of range warns and is
+ * dropped.
  *
  * @param addr: the address in calling memory of the data to return
  * @param  val: the value to set the data in memory to
  **/
 void memory::set32(uint32_t addr, uint32_t val)
 {
+	//Fast path, the whole value is in one page of memory
+	if (addr < size && size - addr >= 4 && (addr & (page_size - 1)) <= page_size - 4)
+	{
+		//Lets decoded copies of this page, and reservations on it, know it changed
+		if (as_atomic(watched[addr >> page_shift]).load(std::memory_order_relaxed))
+		{
+			page_written(addr, 4);
+		}
+
+		//An aligned value is written whole
+		uint8_t* p = writable_page(addr) + (addr & (page_size - 1));
+		if ((addr & 3) == 0)
+		{
+			store_relaxed<uint32_t>(p, val);
+		}
+		else
+		{
+			store_relaxed<uint8_t>(p, val);
+			store_relaxed<uint8_t>(p + 1, val >> 8);
+			store_relaxed<uint8_t>(p + 2, val >> 16);
+			store_relaxed<uint8_t>(p + 3, val >> 24);
+		}
+		return;
+	}
+
 	//Gets the 2 byte parts of the 4 byte value
 	uint16_t part1 = (val >> 16) & 0xffff;
 	uint16_t part2 = (val >> 0) & 0xffff;
@@ -201,6 +698,31 @@ void memory::set32(uint32_t addr, uint32_t val)
 	set16(addr + 2, part1);
 }
 
+/**
+ * Gets an aligned word of memory for an atomic instruction to read and write
+ * with host atomics. It is marked written and reported to code observers,
+ * and reservations on it are broken, first, as set32 would.
+ *
+ * @param addr: address of the word
+ *
+ * @return: the word, or nullptr if not aligned or not all in memory, with a
+ *          warning if out of range
+ **/
+std::atomic<uint32_t>* memory::atomic_word(uint32_t addr)
+{
+	if ((addr & 3) != 0 || !check_address(addr) || addr >= size)
+	{
+		return nullptr;
+	}
+
+	if (as_atomic(watched[addr >> page_shift]).load(std::memory_order_relaxed))
+	{
+		page_written(addr, 4);
+	}
+
+	return &as_atomic(*reinterpret_cast<uint32_t*>(writable_page(addr) + (addr & (page_size - 1))));
+}
+
 /**
  * Prints all the data in memory to standard out in a hex and ASCII formatted manner.
  *
@@ -208,35 +730,81 @@ void memory::set32(uint32_t addr, uint32_t val)
  *   Every 16 bytes, ASCII rep and new line and address
  *   After 8 bytes, print extra space
  *   Every byte, print get(8) of address and print space
+ *
+ * Compressed, a run of lines the same as the one before them is printed as a
+ * single "*" line, like hexdump does, and pages never loaded or written are
+ * skipped without being formatted. The last line is always printed.
+ *
+ * @param compress: collapse repeated lines
  **/
-void memory::dump() const
+void memory::dump(bool compress) const
 {
+	//A whole line is formatted here and written at once
+	char line[hex32_len + 2 + 16 * 3 + 1 + 19];
+	char* p = line;
+
 	//Char array to store ascii representation of the line
 	char ascii[17];
 
+	//Bytes of the last line printed, and whether lines are being skipped
+	uint8_t last[16];
+	bool have_last = false;
+	bool skipping = false;
+
 	//Loops through memory printing all values
 	for (uint32_t i = 0; i < size; i++)
 	{
+		if (compress && i % 16 == 0)
+		{
+			uint32_t page_end = (i | (page_size - 1)) + 1;
+			const uint8_t* bytes = pages[i >> page_shift] + (i & (page_size - 1));
+
+			//A line the same as the last one printed is left out, unless it is the last
+			if (have_last && size - i > 16 && memcmp(bytes, last, 16) == 0)
+			{
+				if (!skipping)
+				{
+					cout.write("*\n", 2);
+					skipping = true;
+				}
+
+				//An untouched page of 0xa5 is the same all the way through
+				if (!touched[i >> page_shift] && last[0] == 0xa5 && memcmp(last, last + 1, 15) == 0 && page_end < size - 16)
+				{
+					i = page_end - 1;
+				}
+				else
+				{
+					i += 15;
+				}
+				continue;
+			}
+
+			memcpy(last, bytes, 16);
+			have_last = true;
+			skipping = false;
+		}
+
 		//For every new line except the last, puts the line's leading address at the front
 		if (i % 16 == 0 && i + 1 != size)
 		{
-			cout << hex32(i) << ": ";
+			p = hex32(p, i);
+			*p++ = ':';
+			*p++ = ' ';
 		}
 
 		//Puts an extra space between the sets of 8 bytes
 		if ((i + 8) % 16 == 0)
 		{
-			cout << " ";
+			*p++ = ' ';
 		}
 
 		//Gets byte at current address
 		uint8_t byte = get8(i);
 
 		//Prints byte and space
-		cout << setw(2);
-		cout << setfill('0');
-		cout << hex << static_cast<int>(byte) << " ";
-		cout << dec;
+		p = hex8(p, byte);
+		*p++ = ' ';
 
 		//Adds ASCII representation of byte to ascii char array for the line
 		ascii[i % 16] = isprint(byte) ? byte : '.';
@@ -244,20 +812,328 @@ void memory::dump() const
 		//Every 16 bytes prints out the ASCII array and goes to a new line
 		if (i % 16 == 15)
 		{
-			cout << "*";
-
-			for (int j = 0; j < 16; j++)
-			{
-				cout << ascii[j];
-			}
+			*p++ = '*';
+			memcpy(p, ascii, 16);
+			p += 16;
+			*p++ = '*';
+			*p++ = '\n';
 
-			cout << "*\n";
+			cout.write(line, p - line);
+			p = line;
 		}
 	}
+
+	//Prints whatever is left of an unfinished line
+	cout.write(line, p - line);
 }
 
 /**
- * Opens passed file in binary mode and reads contents into calling memory
+ * Returns the parts of memory that have been loaded or written, as whole
+ * pages cut off at the end of memory
+ *
+ * @return: [begin, end) address ranges, in order and not touching each other
+ **/
+std::vector<std::pair<uint32_t, uint32_t>> memory::touched_ranges() const
+{
+	std::vector<std::pair<uint32_t, uint32_t>> ranges;
+
+	for (uint32_t page = 0; page < touched.size(); page++)
+	{
+		if (touched[page])
+		{
+			add_page_range(ranges, page);
+		}
+	}
+
+	return ranges;
+}
+
+/**
+ * Checks if a page has been written since the program was loaded (or since
+ * clear_dirty)
+ *
+ * @param page: page number, address >> page_shift
+ *
+ * @return: true if the page has been written
+ **/
+bool memory::is_dirty(uint32_t page) const
+{
+	return (dirty[page >> 6] >> (page & 63)) & 1;
+}
+
+/**
+ * Returns the parts of memory written since the program was loaded (or since
+ * clear_dirty), as whole pages cut off at the end of memory
+ *
+ * @return: [begin, end) address ranges, in order and not touching each other
+ **/
+std::vector<std::pair<uint32_t, uint32_t>> memory::dirty_ranges() const
+{
+	std::vector<std::pair<uint32_t, uint32_t>> ranges;
+
+	//Skips 64 clean pages at a time
+	for (uint32_t word = 0; word < dirty.size(); word++)
+	{
+		for (uint64_t bits = dirty[word]; bits != 0; bits &= bits - 1)
+		{
+			uint32_t bit = 0;
+			while (((bits >> bit) & 1) == 0)
+			{
+				bit++;
+			}
+			add_page_range(ranges, word * 64 + bit);
+		}
+	}
+
+	return ranges;
+}
+
+/**
+ * Marks every page clean, so only later writes show up as dirty
+ **/
+void memory::clear_dirty()
+{
+	dirty.assign(dirty.size(), 0);
+}
+
+/**
+ * Adds a page to a list of address ranges, joining it to the last range
+ * when they touch
+ *
+ * @param ranges: ranges to add to, in order
+ * @param   page: page number, after every page already in ranges
+ **/
+void memory::add_page_range(std::vector<std::pair<uint32_t, uint32_t>>& ranges, uint32_t page) const
+{
+	uint32_t begin = page << page_shift;
+	uint32_t end = static_cast<uint32_t>(min<uint64_t>(static_cast<uint64_t>(begin) + page_size, size));
+	if (begin >= end)
+	{
+		return;
+	}
+
+	if (!ranges.empty() && ranges.back().second == begin)
+	{
+		ranges.back().second = end;
+	}
+	else
+	{
+		ranges.push_back(std::make_pair(begin, end));
+	}
+}
+
+/**
+ * Writes the memory's size, entry point, program break and contents to a
+ * checkpoint
+ *
+ * Pages never loaded or written are still 0xa5 and are left out. Touched
+ * pages holding nothing but 0xa5 are written as just their page number, so
+ * restoring them keeps the -c dumps the same without storing their bytes.
+ *
+ * @param out: stream the checkpoint is being written to
+ *
+ * @return: whether everything was written
+ **/
+bool memory::save(std::ostream& out) const
+{
+	put_le32(out, size);
+	put_le32(out, entry);
+	put_le32(out, brk);
+
+	for (uint32_t page = 0; page < pages.size(); page++)
+	{
+		if (!touched[page])
+		{
+			continue;
+		}
+
+		if (memcmp(pages[page], fill, page_size) == 0)
+		{
+			put_le32(out, page | checkpoint_fill_page);
+		}
+		else
+		{
+			put_le32(out, page);
+			out.write(reinterpret_cast<const char*>(pages[page]), page_size);
+		}
+	}
+
+	put_le32(out, checkpoint_end);
+	return out.good();
+}
+
+/**
+ * Replaces the memory's size, entry point, program break and contents with
+ * those written by save()
+ *
+ * Memory keeps being flat or paged as it was. Every page starts again as
+ * 0xa5 before the saved ones are read back, and nothing is dirty or watched
+ * afterwards, so anything decoded from the old contents must be thrown away
+ * by whoever restores it.
+ *
+ * @param in: stream positioned at the saved memory
+ *
+ * @return false: the saved memory was cut short or malformed
+ *		    true: memory restored
+ **/
+bool memory::restore(std::istream& in)
+{
+	uint8_t head[12];
+	if (!in.read(reinterpret_cast<char*>(head), sizeof(head)))
+	{
+		return false;
+	}
+
+	bool paged = flat == nullptr;
+	release();
+	allocate(le32(head), paged);
+	entry = le32(head + 4);
+	brk = le32(head + 8);
+
+	while (true)
+	{
+		uint8_t tag[4];
+		if (!in.read(reinterpret_cast<char*>(tag), sizeof(tag)))
+		{
+			return false;
+		}
+
+		uint32_t page = le32(tag);
+		if (page == checkpoint_end)
+		{
+			break;
+		}
+
+		bool filled = (page & checkpoint_fill_page) != 0;
+		page &= ~checkpoint_fill_page;
+		if (page >= pages.size())
+		{
+			return false;
+		}
+
+		if (filled)
+		{
+			touched[page] = 1;
+		}
+		else if (!in.read(reinterpret_cast<char*>(writable_page(page << page_shift)), page_size))
+		{
+			return false;
+		}
+	}
+
+	clear_dirty();
+	return true;
+}
+
+/**
+ * Takes a snapshot of memory that rollback() or the snapshot constructor
+ * can return to
+ *
+ * No bytes are copied for pages this memory allocated itself: the snapshot
+ * takes them over and both share them until memory writes one again, which
+ * copies it first. Pages in the flat buffer or a file mapping are copied
+ * once, since they go away with this memory. Taking snapshots over and over
+ * copies only the pages written in between.
+ *
+ * @return: the snapshot
+ **/
+memory_snapshot memory::snapshot()
+{
+	memory_snapshot s;
+	s.size = size;
+	s.entry = entry;
+	s.brk = brk;
+	s.dirty = dirty;
+	s.pages.resize(pages.size());
+
+	for (uint32_t page = 0; page < pages.size(); page++)
+	{
+		if (!touched[page])
+		{
+			continue;
+		}
+
+		if (!shared[page])
+		{
+			uint8_t* p = pages[page];
+			if (!owns_page(page))
+			{
+				p = new uint8_t[page_size];
+				memcpy(p, pages[page], page_size);
+			}
+			shared[page] = std::shared_ptr<uint8_t>(p, std::default_delete<uint8_t[]>());
+			pages[page] = p;
+		}
+		s.pages[page] = shared[page];
+	}
+
+	return s;
+}
+
+/**
+ * Puts memory back the way it was when a snapshot was taken
+ *
+ * Only pages that differ from the snapshot are touched, each pointed back at
+ * the snapshot's copy instead of copied. Watched code on those pages is
+ * reported as written, so decoded copies of it are thrown away.
+ *
+ * @param s: snapshot to return to
+ **/
+void memory::rollback(const memory_snapshot& s)
+{
+	if (s.size != size)
+	{
+		bool paged = flat == nullptr;
+		release();
+		allocate(s.size, paged);
+	}
+
+	entry = s.entry;
+	brk = s.brk;
+
+	for (uint32_t page = 0; page < pages.size(); page++)
+	{
+		uint8_t* p = s.pages[page].get();
+		if (p == pages[page] || (p == nullptr && !touched[page]))
+		{
+			continue;
+		}
+
+		if (watched[page] & watched_code)
+		{
+			code_written(page << page_shift);
+		}
+
+		free_page(page);
+		if (p != nullptr)
+		{
+			shared[page] = s.pages[page];
+			pages[page] = p;
+		}
+		else if (flat != nullptr)
+		{
+			pages[page] = flat + static_cast<size_t>(page) * page_size;
+			memset(pages[page], 0xa5, page_size);
+		}
+		else
+		{
+			pages[page] = fill;
+		}
+		touched[page] = p != nullptr;
+	}
+
+	dirty = s.dirty;
+}
+
+/**
+ * Opens passed file in binary mode and reads contents into calling memory
+ *
+ * ELF files are loaded by load_elf. Anything else is a flat binary, whose
+ * size is checked once up front before it is read a page at a time straight
+ * into memory at address 0. Paged memory on POSIX hosts maps the file's
+ * whole pages copy-on-write instead of reading them, so they are only read
+ * from disk when touched and stay shared with anything else mapping the file
+ * until the program writes them.
  *
  * @param fname: reference to file to open and read into memory
  *
@@ -266,8 +1142,8 @@ void memory::dump() const
  **/
 bool memory::load_file(const std::string& fname)
 {
-	//Opens file in binary mode
-	ifstream infile(fname, ios::in | ios::binary);
+	//Opens file in binary mode, at the end to get its size
+	ifstream infile(fname, ios::in | ios::binary | ios::ate);
 
 	//Outputs error and returns false if file could not be opened
 	if (!infile.is_open())
@@ -276,38 +1152,482 @@ bool memory::load_file(const std::string& fname)
 		return false;
 	}
 
-	int8_t readByte;
+	uint64_t file_size = static_cast<uint64_t>(infile.tellg());
+
+	//Checks for the ELF magic number
+	char magic[4] = {};
+	infile.seekg(0);
+	infile.read(magic, sizeof(magic));
+	infile.clear();
+	if (memcmp(magic, "\x7f" "ELF", sizeof(magic)) == 0)
+	{
+		return load_elf(infile, fname);
+	}
 
-	//Tells infile to not skip whitespaces while reading
-	infile >> std::noskipws;
+	//Outputs error and returns false if file size exceeds memory size
+	if (file_size > static_cast<uint64_t>(size) + 1)
+	{
+		cerr << "Program too big." << endl;
+		return false;
+	}
 
-	//Reads file byte by byte and checks each byte address before writing to ensure file does not exceed memory size
+	//Maps what it can, then reads the rest a page at a time
 	uint32_t address = 0;
-	while (infile >> readByte)
+	if (flat == nullptr)
+	{
+		address = map_file(fname, file_size);
+	}
+
+	infile.seekg(address);
+	if (!read_pages(infile, address, file_size - address))
+	{
+		cerr << "Can't read file \"" << fname << "\"." << endl;
+		return false;
+	}
+
+	entry = 0;
+	brk = heap_start(file_size, size);
+	clear_dirty();
+	return true;
+}
+
+/**
+ * Loads an ELF32 RISC-V executable
+ *
+ * Each PT_LOAD segment's file bytes are read to its virtual address and the
+ * rest of its memory size (.bss) is zeroed. Memory outside the segments is
+ * not touched. The entry point is kept for get_entry.
+ *
+ * @param infile: the opened file
+ * @param  fname: name of the file, for messages
+ *
+ * @return false: the file is not a RISC-V ELF32 executable or a segment
+ *                does not fit in memory
+ *		    true: every segment was loaded
+ **/
+bool memory::load_elf(std::istream& infile, const std::string& fname)
+{
+	static constexpr uint32_t elf_header_size = 52;
+	static constexpr uint32_t elf_phdr_size = 32;
+	static constexpr uint8_t elfclass32 = 1;
+	static constexpr uint8_t elfdata2lsb = 1;
+	static constexpr uint16_t et_exec = 2;
+	static constexpr uint16_t em_riscv = 243;
+	static constexpr uint32_t pt_load = 1;
+
+	uint8_t eh[elf_header_size];
+	infile.seekg(0);
+	if (!infile.read(reinterpret_cast<char*>(eh), sizeof(eh)))
+	{
+		cerr << "Can't read ELF header of \"" << fname << "\"." << endl;
+		return false;
+	}
+
+	if (eh[4] != elfclass32 || eh[5] != elfdata2lsb || le16(eh + 16) != et_exec || le16(eh + 18) != em_riscv)
+	{
+		cerr << "\"" << fname << "\" is not a 32 bit little-endian RISC-V executable." << endl;
+		return false;
+	}
+
+	uint32_t e_entry = le32(eh + 24);
+	uint32_t e_phoff = le32(eh + 28);
+	uint16_t e_phentsize = le16(eh + 42);
+	uint16_t e_phnum = le16(eh + 44);
+	uint64_t end = 0;
+
+	if (e_phentsize < elf_phdr_size)
+	{
+		cerr << "Bad program headers in \"" << fname << "\"." << endl;
+		return false;
+	}
+
+	for (uint32_t i = 0; i < e_phnum; i++)
 	{
-		//Adds byte to memory only if byte would be within memory size
-		if (address <= size)
+		uint8_t ph[elf_phdr_size];
+		infile.seekg(static_cast<uint64_t>(e_phoff) + static_cast<uint64_t>(i) * e_phentsize);
+		if (!infile.read(reinterpret_cast<char*>(ph), sizeof(ph)))
 		{
-			//Ignores /r for Windows newline (Windows formatting)
-			//if (readByte != 0x0d)
-			//{
-			//	mem[address] = readByte;
-			//	address++;
-			//}
-		
-			//(Unix formatting)
-			mem[address] = readByte;
-			address++;
+			cerr << "Bad program headers in \"" << fname << "\"." << endl;
+			return false;
 		}
 
-		//Outputs error and returns false if file size exceeds memory size
-		else
+		if (le32(ph + 0) != pt_load)
+		{
+			continue;
+		}
+
+		uint32_t p_offset = le32(ph + 4);
+		uint32_t p_vaddr = le32(ph + 8);
+		uint32_t p_filesz = le32(ph + 16);
+		uint32_t p_memsz = le32(ph + 20);
+
+		//Outputs error and returns false if the segment is outside memory
+		if (p_filesz > p_memsz || static_cast<uint64_t>(p_vaddr) + p_memsz > size)
 		{
 			cerr << "Program too big." << endl;
 			return false;
 		}
+
+		infile.seekg(p_offset);
+		if (!read_pages(infile, p_vaddr, p_filesz))
+		{
+			cerr << "Can't read file \"" << fname << "\"." << endl;
+			return false;
+		}
+
+		end = max<uint64_t>(end, static_cast<uint64_t>(p_vaddr) + p_memsz);
+
+		//Zeroes the part of the segment not in the file
+		for (uint32_t addr = p_vaddr + p_filesz; addr < p_vaddr + p_memsz; )
+		{
+			uint32_t offset = addr & (page_size - 1);
+			uint32_t count = min(page_size - offset, p_vaddr + p_memsz - addr);
+			memset(writable_page(addr) + offset, 0, count);
+			addr += count;
+		}
 	}
 
+	entry = e_entry;
+	brk = heap_start(end, size);
+	clear_dirty();
 	return true;
 }
 
+/**
+ * Reads bytes from a stream into memory a page at a time
+ *
+ * @param infile: stream positioned at the first byte to read
+ * @param   addr: address to read to, the whole range already checked
+ * @param  count: bytes to read
+ *
+ * @return: false if the stream ran out first
+ **/
+bool memory::read_pages(std::istream& infile, uint32_t addr, uint64_t count)
+{
+	while (count > 0)
+	{
+		uint32_t offset = addr & (page_size - 1);
+		uint32_t n = static_cast<uint32_t>(min<uint64_t>(page_size - offset, count));
+
+		if (!infile.read(reinterpret_cast<char*>(writable_page(addr) + offset), n))
+		{
+			return false;
+		}
+		addr += n;
+		count -= n;
+	}
+
+	return true;
+}
+
+/**
+ * Returns where the last loaded program starts, 0 for flat binaries
+ *
+ * @return: entry point address
+ **/
+uint32_t memory::get_entry() const
+{
+	return entry;
+}
+
+/**
+ * Returns the program break: the end of the heap, which starts at the page
+ * after the last byte the program was loaded to
+ *
+ * @return: program break address
+ **/
+uint32_t memory::get_brk() const
+{
+	return brk;
+}
+
+/**
+ * Moves the program break
+ *
+ * @param addr: new program break, already checked to be in memory
+ **/
+void memory::set_brk(uint32_t addr)
+{
+	brk = addr;
+}
+
+/**
+ * Maps the whole pages at the start of a file copy-on-write over the pages
+ * of paged memory. A partial last page is left to be read, since the rest of
+ * it must read as 0xa5 rather than the zeros mmap fills it with.
+ *
+ * @param     fname: file to map
+ * @param file_size: size of the file, already checked to fit
+ *
+ * @return: bytes mapped, 0 if nothing could be or the host is Windows
+ **/
+uint32_t memory::map_file(const std::string& fname, uint64_t file_size)
+{
+#if defined(_WIN32)
+	return 0;
+#else
+	size_t length = static_cast<size_t>(file_size) & ~static_cast<size_t>(page_size - 1);
+	if (length == 0 || mapped != nullptr)
+	{
+		return 0;
+	}
+
+	int fd = open(fname.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return 0;
+	}
+
+	void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+	{
+		return 0;
+	}
+
+	mapped = static_cast<uint8_t*>(p);
+	mapped_size = length;
+
+	//Pages written before loading have their own copies to free
+	for (size_t i = 0; i < length / page_size; i++)
+	{
+		free_page(static_cast<uint32_t>(i));
+		pages[i] = mapped + i * page_size;
+		touched[i] = 1;
+	}
+
+	return static_cast<uint32_t>(length);
+#endif
+}
+
+/**
+ * Adds an observer to be told when watched code is written
+ *
+ * @param o: observer to add
+ **/
+void memory::add_code_observer(code_observer* o)
+{
+	observers.push_back(o);
+}
+
+/**
+ * Removes an observer added with add_code_observer
+ *
+ * @param o: observer to remove
+ **/
+void memory::remove_code_observer(code_observer* o)
+{
+	for (size_t i = 0; i < observers.size(); i++)
+	{
+		if (observers[i] == o)
+		{
+			observers.erase(observers.begin() + i);
+			return;
+		}
+	}
+}
+
+/**
+ * Marks the page holding the passed address as containing decoded code, so
+ * the next write to it is reported to the code observers
+ *
+ * @param addr: address of the decoded code
+ **/
+void memory::watch_code(uint32_t addr)
+{
+	if (addr < size)
+	{
+		as_atomic(watched[addr >> page_shift]).fetch_or(watched_code, std::memory_order_relaxed);
+	}
+}
+
+/**
+ * Stops watching the written page and tells every observer that it changed
+ *
+ * @param addr: address being written
+ **/
+void memory::code_written(uint32_t addr)
+{
+	uint32_t page = addr >> page_shift;
+	as_atomic(watched[page]).fetch_and(static_cast<uint8_t>(~watched_code), std::memory_order_relaxed);
+
+	for (code_observer* o : observers)
+	{
+		o->code_modified(page);
+	}
+}
+
+/**
+ * Tells whatever watches the page holding a write that it is about to
+ * change: code observers, and harts with a reservation on the bytes written
+ *
+ * @param addr: first byte being written
+ * @param  len: bytes being written, all on one page
+ **/
+void memory::page_written(uint32_t addr, uint32_t len)
+{
+	uint8_t w = as_atomic(watched[addr >> page_shift]).load(std::memory_order_relaxed);
+	if (w & watched_code)
+	{
+		code_written(addr);
+	}
+	if (w & watched_reserved)
+	{
+		break_reservations(addr, len);
+	}
+}
+
+/**
+ * Reserves a word for a hart's lr.w, replacing any reservation the hart
+ * already had. Every write to the word from then on, by any hart, a system
+ * call or an AMO, breaks the reservation, until store_conditional uses it.
+ *
+ * The word must be read after this returns, so a write the reservation
+ * missed, one already under way, is still seen in the value lr.w reads.
+ *
+ * @param addr: address of the word, aligned
+ * @param hart: id of the hart reserving it
+ **/
+void memory::reserve(uint32_t addr, uint32_t hart)
+{
+	if (addr >= size)
+	{
+		return;
+	}
+
+	{
+		lock_guard<mutex> guard(reservation_lock);
+		drop_reservation(hart);
+		reservations.push_back(make_pair(hart, addr));
+		as_atomic(watched[addr >> page_shift]).fetch_or(watched_reserved, std::memory_order_seq_cst);
+	}
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+/**
+ * Stores a word for a hart's sc.w if the hart's reservation on it is still
+ * unbroken and the word still holds what lr.w read. Any store ends every
+ * reservation on the word, the hart's own included.
+ *
+ * @param     addr: address of the word, aligned and in memory
+ * @param     hart: id of the hart storing
+ * @param expected: what lr.w read
+ * @param      val: value to store
+ * @param     seen: set to what the word held
+ *
+ * @return: whether the word was stored
+ **/
+bool memory::store_conditional(uint32_t addr, uint32_t hart, uint32_t expected, uint32_t val, uint32_t& seen)
+{
+	lock_guard<mutex> guard(reservation_lock);
+
+	bool held = false;
+	for (const std::pair<uint32_t, uint32_t>& r : reservations)
+	{
+		if (r.first == hart && r.second == addr)
+		{
+			held = true;
+		}
+	}
+	if (!held)
+	{
+		seen = load_relaxed<uint32_t>(pages[addr >> page_shift] + (addr & (page_size - 1)));
+		return false;
+	}
+
+	drop_reservations(addr, 4);
+	if (as_atomic(watched[addr >> page_shift]).load(std::memory_order_relaxed) & watched_code)
+	{
+		code_written(addr);
+	}
+
+	std::atomic<uint32_t>& word = as_atomic(*reinterpret_cast<uint32_t*>(writable_page(addr) + (addr & (page_size - 1))));
+	seen = expected;
+	return word.compare_exchange_strong(seen, val);
+}
+
+/**
+ * Ends a hart's reservation, if it has one, as when it is reset or rolled
+ * back
+ *
+ * @param hart: id of the hart
+ **/
+void memory::cancel_reservation(uint32_t hart)
+{
+	lock_guard<mutex> guard(reservation_lock);
+	drop_reservation(hart);
+}
+
+/**
+ * Ends every reservation on the bytes being written
+ *
+ * @param addr: first byte being written
+ * @param  len: bytes being written
+ **/
+void memory::break_reservations(uint32_t addr, uint32_t len)
+{
+	lock_guard<mutex> guard(reservation_lock);
+	drop_reservations(addr, len);
+}
+
+/**
+ * Removes a hart's reservation, with reservation_lock held
+ *
+ * @param hart: id of the hart
+ **/
+void memory::drop_reservation(uint32_t hart)
+{
+	for (size_t i = 0; i < reservations.size(); i++)
+	{
+		if (reservations[i].first == hart)
+		{
+			uint32_t page = reservations[i].second >> page_shift;
+			reservations.erase(reservations.begin() + i);
+			unwatch_reserved(page);
+			return;
+		}
+	}
+}
+
+/**
+ * Removes every reservation on a word overlapping the passed bytes, with
+ * reservation_lock held
+ *
+ * @param addr: first byte
+ * @param  len: how many bytes
+ **/
+void memory::drop_reservations(uint32_t addr, uint32_t len)
+{
+	uint64_t end = static_cast<uint64_t>(addr) + len;
+	for (size_t i = 0; i < reservations.size(); )
+	{
+		uint32_t word = reservations[i].second;
+		if (word < end && addr < static_cast<uint64_t>(word) + 4)
+		{
+			reservations.erase(reservations.begin() + i);
+			unwatch_reserved(word >> page_shift);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+/**
+ * Stops sending writes to a page through break_reservations once no
+ * reservation is left on it, with reservation_lock held
+ *
+ * @param page: page number
+ **/
+void memory::unwatch_reserved(uint32_t page)
+{
+	for (const std::pair<uint32_t, uint32_t>& r : reservations)
+	{
+		if (r.second >> page_shift == page)
+		{
+			return;
+		}
+	}
+	as_atomic(watched[page]).fetch_and(static_cast<uint8_t>(~watched_reserved), std::memory_order_relaxed);
+}
@@ -9,33 +9,135 @@
 #ifndef memory_H
 #define memory_H
 
+#include <atomic>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
 #include <string>
+#include <utility>
+#include <vector>
+#include <stddef.h>
 #include <stdint.h>
 
+/**
+ * Interface for anything holding decoded copies of memory contents that must
+ * be thrown away when the bytes underneath them are written
+ **/
+class code_observer
+{
+public:
+	virtual ~code_observer() {}
+	virtual void code_modified(uint32_t page) = 0;
+};
+
+/**
+ * Contents of a memory at one moment, sharing its pages with the memory it
+ * was taken from and with other snapshots until one of them writes to them
+ **/
+class memory_snapshot
+{
+private:
+	friend class memory;
+	uint32_t size;
+	uint32_t entry;
+	uint32_t brk;
+	std::vector<std::shared_ptr<uint8_t>> pages;     //bytes of each page, or nullptr if never loaded or written
+	std::vector<uint64_t> dirty;
+};
+
 class memory
 {
 public:
-	memory(std::uint32_t siz);
+	static constexpr uint32_t page_shift = 12;
+	static constexpr uint32_t page_size = 1 << page_shift;
+
+	memory(std::uint32_t siz, bool paged = false);
+	explicit memory(const memory_snapshot& s, bool paged = true);
 	~memory();
 
 	bool check_address(uint32_t i) const;
 	uint32_t get_size() const;
+	void set_quiet(bool b);
 
 	uint8_t get8(uint32_t addr) const;
+	uint8_t peek8(uint32_t addr) const;
 	uint16_t get16(uint32_t addr) const;
 	uint32_t get32(uint32_t addr) const;
+	uint32_t peek32(uint32_t addr) const;
 
 	void set8(uint32_t addr, uint8_t val);
 	void set16(uint32_t addr, uint16_t val);
 	void set32(uint32_t addr, uint32_t val);
+	std::atomic<uint32_t>* atomic_word(uint32_t addr);
+
+	const uint8_t* read_span(uint32_t addr, uint32_t& len) const;
+	uint8_t* write_span(uint32_t addr, uint32_t& len);
+	void span_written(uint32_t addr, uint32_t len);
+
+	void reserve(uint32_t addr, uint32_t hart);
+	bool store_conditional(uint32_t addr, uint32_t hart, uint32_t expected, uint32_t val, uint32_t& seen);
+	void cancel_reservation(uint32_t hart);
 
-	void dump() const;
+	void dump(bool compress = false) const;
+	std::vector<std::pair<uint32_t, uint32_t>> touched_ranges() const;
+
+	bool is_dirty(uint32_t page) const;
+	std::vector<std::pair<uint32_t, uint32_t>> dirty_ranges() const;
+	void clear_dirty();
 
 	bool load_file(const std::string& fname);
+	uint32_t get_entry() const;
+	uint32_t get_brk() const;
+	void set_brk(uint32_t addr);
+
+	bool save(std::ostream& out) const;
+	bool restore(std::istream& in);
+
+	memory_snapshot snapshot();
+	void rollback(const memory_snapshot& s);
+
+	void add_code_observer(code_observer* o);
+	void remove_code_observer(code_observer* o);
+	void watch_code(uint32_t addr);
 
 private:
-	uint8_t* mem;         //the actual memory buffer
+	uint8_t* flat;                    //every page in one buffer, or nullptr when paged
+	uint8_t* fill;                    //page of 0xa5 shared by paged pages never written
+	std::vector<uint8_t*> pages;      //bytes of each page, including the one holding address size
+	uint8_t* mapped;                  //file mapped copy-on-write under the first pages, if any
+	size_t mapped_size;
 	uint32_t size;
+	uint32_t entry;                   //where the loaded program starts
+	uint32_t brk;                     //end of the loaded program's heap, moved by the brk system call
+	bool quiet;                       //leave out of range warnings to someone else
+
+	std::vector<uint8_t> touched;                //nonzero for pages loaded or written since creation
+	std::vector<uint64_t> dirty;                 //bit per page written since the program was loaded
+	std::vector<uint8_t> watched;                //bits for what must hear of writes to each page
+	std::vector<code_observer*> observers;       //told when a watched page is written
+	std::vector<std::shared_ptr<uint8_t>> shared;    //owner of each page a snapshot holds, copied before it is written
+	std::mutex reservation_lock;
+	std::vector<std::pair<uint32_t, uint32_t>> reservations;    //hart id and word address of each lr.w reservation
+
+	void allocate(uint32_t siz, bool paged);
+	void release();
+	bool owns_page(uint32_t page) const;
+	void free_page(uint32_t page);
+	uint8_t* writable_page(uint32_t addr);
+	void mark_written(uint32_t page);
+	uint8_t* private_page(uint32_t page);
+	uint32_t span_length(uint32_t addr, uint32_t len) const;
+	uint32_t map_file(const std::string& fname, uint64_t file_size);
+	bool load_elf(std::istream& infile, const std::string& fname);
+	bool read_pages(std::istream& infile, uint32_t addr, uint64_t count);
+	void code_written(uint32_t addr);
+	void page_written(uint32_t addr, uint32_t len);
+	void break_reservations(uint32_t addr, uint32_t len);
+	void drop_reservation(uint32_t hart);
+	void drop_reservations(uint32_t addr, uint32_t len);
+	void unwatch_reserved(uint32_t page);
+	void add_page_range(std::vector<std::pair<uint32_t, uint32_t>>& ranges, uint32_t page) const;
 };
 
 #endif
\ No newline at end of file
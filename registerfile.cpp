@@ -6,6 +6,8 @@
 //  Created by Daniel Widing (z1838064)
 //
 //*****************************************************************************
+#include <cstring>
+
 #include "registerfile.h"
 
 using namespace std;
@@ -66,31 +68,47 @@ int32_t registerfile::get(uint32_t r) const
 	}
 }
 
+/**
+ * Returns the register array itself for execution engines that skip get and
+ * set. They must put 0 back in x0 after writing to it.
+ *
+ * @return: pointer to the 32 registers
+ **/
+int32_t* registerfile::data()
+{
+	return registers;
+}
+
 /**
  * Outputs a dump of all registers to standard out
  **/
 void registerfile::dump() const
 {
-	int regCount = 0;
-	
-	//Creates string of dump to print to stdout
+	//Leading register counters, right aligned to 3 characters
+	static const char labels[4][4] = { " x0", " x8", "x16", "x24" };
+
+	//Each line of 8 registers is formatted here and written at once
+	char line[3 + 8 * (1 + hex32_len)];
+	char* p = line;
+
 	for (int i = 0; i < 32; i++)
 	{
 		//Leading register counter every 8 registers
-		if (regCount == 0 || regCount == 8 || regCount == 16 || regCount == 24)
+		if (i % 8 == 0)
 		{
-			cout << setw(3) << setfill(' ') << right << "x" + to_string(regCount);
+			memcpy(line, labels[i / 8], 3);
+			p = line + 3;
 		}
 
 		//Register value
-		cout << " " + hex32(get(i));
-
-		regCount++;
+		*p++ = ' ';
+		p = hex32(p, get(i));
 
 		//Newline for every 8 registers
-		if (regCount == 8 || regCount == 16 || regCount == 24 || regCount == 32)
+		if (i % 8 == 7)
 		{
+			cout.write(line, p - line);
 			cout << endl;
 		}
 	}
-}
\ No newline at end of file
+}
@@ -26,6 +26,7 @@ public:
 	void reset();
 	void set(uint32_t r, int32_t val);
 	int32_t get(uint32_t r) const;
+	int32_t* data();
 	void dump() const;
 };
 
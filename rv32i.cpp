@@ -15,8 +15,16 @@
 #include <cstring>
 #include <sstream>
 #include <cassert>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
 
+#include "compressed.h"
 #include "rv32i.h"
+#include "syscalls.h"
+#include "trace.h"
 
 using namespace std;
 
@@ -26,69 +34,358 @@ static uint32_t get_funct3(uint32_t insn);
 static uint32_t get_rs1(uint32_t insn);
 static uint32_t get_rs2(uint32_t insn);
 static uint32_t get_funct7(uint32_t insn);
+static uint32_t get_funct5(uint32_t insn);
 static uint32_t get_imm_u(uint32_t insn);
 static uint32_t get_imm_j(uint32_t insn);
 static uint32_t get_imm_i(uint32_t insn);
 static uint32_t get_imm_s(uint32_t insn);
 static uint32_t get_imm_b(uint32_t insn);
+static int32_t get_imm(uint32_t insn);
+static uint8_t get_op(uint32_t insn);
+
+static const chrono::steady_clock::time_point sim_start = chrono::steady_clock::now();     //when the time CSR read 0
+
+/**
+ * Handler for each operation, indexed by insn_op
+ **/
+void (rv32i::* const rv32i::exec_table[op_count])(const decoded_insn& d, std::ostream* pos) =
+{
+	&rv32i::exec_illegal_insn,
+	&rv32i::exec_lui,
+	&rv32i::exec_auipc,
+	&rv32i::exec_jal,
+	&rv32i::exec_jalr,
+	&rv32i::exec_beq,
+	&rv32i::exec_bne,
+	&rv32i::exec_blt,
+	&rv32i::exec_bge,
+	&rv32i::exec_bltu,
+	&rv32i::exec_bgeu,
+	&rv32i::exec_lb,
+	&rv32i::exec_lh,
+	&rv32i::exec_lw,
+	&rv32i::exec_lbu,
+	&rv32i::exec_lhu,
+	&rv32i::exec_sb,
+	&rv32i::exec_sh,
+	&rv32i::exec_sw,
+	&rv32i::exec_addi,
+	&rv32i::exec_slti,
+	&rv32i::exec_sltiu,
+	&rv32i::exec_xori,
+	&rv32i::exec_ori,
+	&rv32i::exec_andi,
+	&rv32i::exec_slli,
+	&rv32i::exec_srli,
+	&rv32i::exec_srai,
+	&rv32i::exec_add,
+	&rv32i::exec_sub,
+	&rv32i::exec_sll,
+	&rv32i::exec_slt,
+	&rv32i::exec_sltu,
+	&rv32i::exec_xor,
+	&rv32i::exec_srl,
+	&rv32i::exec_sra,
+	&rv32i::exec_or,
+	&rv32i::exec_and,
+	&rv32i::exec_mul,
+	&rv32i::exec_mulh,
+	&rv32i::exec_mulhsu,
+	&rv32i::exec_mulhu,
+	&rv32i::exec_div,
+	&rv32i::exec_divu,
+	&rv32i::exec_rem,
+	&rv32i::exec_remu,
+	&rv32i::exec_sh1add,
+	&rv32i::exec_sh2add,
+	&rv32i::exec_sh3add,
+	&rv32i::exec_andn,
+	&rv32i::exec_orn,
+	&rv32i::exec_xnor,
+	&rv32i::exec_clz,
+	&rv32i::exec_ctz,
+	&rv32i::exec_cpop,
+	&rv32i::exec_max,
+	&rv32i::exec_maxu,
+	&rv32i::exec_min,
+	&rv32i::exec_minu,
+	&rv32i::exec_sext_b,
+	&rv32i::exec_sext_h,
+	&rv32i::exec_zext_h,
+	&rv32i::exec_rol,
+	&rv32i::exec_ror,
+	&rv32i::exec_rori,
+	&rv32i::exec_orc_b,
+	&rv32i::exec_rev8,
+	&rv32i::exec_fence,
+	&rv32i::exec_ecall,
+	&rv32i::exec_ebreak,
+	&rv32i::exec_csrrw,
+	&rv32i::exec_csrrs,
+	&rv32i::exec_csrrc,
+	&rv32i::exec_csrrwi,
+	&rv32i::exec_csrrsi,
+	&rv32i::exec_csrrci,
+	&rv32i::exec_lr_w,
+	&rv32i::exec_sc_w,
+	&rv32i::exec_amoswap_w,
+	&rv32i::exec_amoadd_w,
+	&rv32i::exec_amoxor_w,
+	&rv32i::exec_amoand_w,
+	&rv32i::exec_amoor_w,
+	&rv32i::exec_amomin_w,
+	&rv32i::exec_amomax_w,
+	&rv32i::exec_amominu_w,
+	&rv32i::exec_amomaxu_w,
+};
 
 /**
  * Constructs rv32i object by saving passed memory pointer to decode
  *
  * @param m: pointer to memory to save in new object for decoding
  **/
-rv32i::rv32i(memory* m) : halt(false), show_instructions(false), show_registers(false), has_insn_limit(false), insn_counter(0)
+rv32i::rv32i(memory* m) : hart_id(0), blocks_stale(false), use_jit(true), halt(false), show_instructions(false), show_registers(false), has_insn_limit(false), insn_counter(0), trace_out(nullptr), trace_ring(nullptr), async_trace(false), reserved(false), reserved_addr(0), reserved_val(0), sc_stored(false), amo_loaded(0), csr_read(0), mscratch(0), replaying(nullptr), sys(nullptr), exited(false), exit_status(0)
 {
 	//Sets object memory to passed memory
 	mem = m;
 
-	//Sets current instruction decoding line to 0 to begin with  
-	pc = 0;
+	//Starts at the loaded program's entry point, with the stack at the top of memory
+	pc = mem->get_entry();
+	stack_top = mem->get_size();
+
+	//One empty decode cache slot per page of memory, told when code is overwritten
+	dcache.assign((mem->get_size() + memory::page_size - 1) >> memory::page_shift, nullptr);
+	bcache.assign(dcache.size(), nullptr);
+	mem->add_code_observer(this);
+}
+
+/**
+ * Stops watching memory for code writes and frees the decode cache
+ **/
+rv32i::~rv32i()
+{
+	mem->remove_code_observer(this);
+
+	for (decoded_insn* entries : dcache)
+	{
+		delete[] entries;
+	}
+
+	flush_blocks();
 }
 
 /**
  * Disassembles all instructions in calling objects memory
  * 
- * Loops through all 32 bit words in memory:
+ * Loops through all instructions in memory, 2 bytes each if compressed and 4
+ * otherwise:
  *   - Print address
  *	 - Print encoded instruction/word
  *   - Decodes instruction
  *   - Prints decoded instruction/error
+ *
+ * Memory is split into chunks that are disassembled on every host core at
+ * once, a round of chunks at a time, then printed in order. With
+ * touched_only, only memory that has been loaded or written is covered and
+ * each gap left out is printed as a "*" line.
+ *
+ * @param touched_only: skip memory never loaded or written
  **/
-void rv32i::disasm()
+void rv32i::disasm(bool touched_only)
 {
-	//Resets instruction address location
-	pc = 0;
+	uint32_t size = mem->get_size();
 
-	//Loops through all bytes
-	while (pc < mem->get_size())
+	vector<pair<uint32_t, uint32_t>> ranges;
+	if (touched_only)
 	{
-		//Print address
-		cout << setw(8) << setfill('0') << hex32(pc) << ": ";
-		
-		//Gets instruction bytes
-		uint32_t insn = mem->get32(pc);
-		
-		//Prints encoded bytes
-		cout << setw(8) << setfill('0') << hex << static_cast<int>(insn) << "  " << dec;
-		
-		//Decodes and prints instruction bytes		
-		cout << decode(insn) << endl;
+		ranges = mem->touched_ranges();
+	}
+	else
+	{
+		ranges.push_back(make_pair(0u, size));
+	}
+
+	//Splits the ranges into chunks, with a gap marker before any range
+	//that does not carry on from the last
+	struct chunk
+	{
+		uint32_t begin;
+		uint32_t end;
+		bool gap;
+	};
+	vector<chunk> chunks;
+	uint32_t covered = 0;
+	for (const pair<uint32_t, uint32_t>& r : ranges)
+	{
+		uint32_t begin = r.first & ~3u;
+		uint32_t end = min<uint64_t>((static_cast<uint64_t>(r.second) + 3) & ~3ull, size);
+		bool gap = begin != covered;
+		for (uint32_t addr = begin; addr < end; addr += disasm_chunk_size)
+		{
+			chunks.push_back({ addr, min(addr + disasm_chunk_size, end), gap && addr == begin });
+		}
+		covered = end;
+	}
+	bool gap_at_end = covered < size;
+
+	unsigned workers = thread::hardware_concurrency();
+	if (workers == 0)
+	{
+		workers = 1;
+	}
+
+	//Text of each chunk in the current round, and where each one stopped
+	vector<string> text(workers * 4);
+	vector<uint32_t> stopped(text.size());
+	uint32_t resume = 0;
+
+	for (size_t first = 0; first < chunks.size(); first += text.size())
+	{
+		uint32_t count = min<size_t>(text.size(), chunks.size() - first);
+
+		//Each worker takes the next chunk not yet started
+		atomic<uint32_t> next(0);
+		auto work = [&]()
+		{
+			for (uint32_t i = next++; i < count; i = next++)
+			{
+				text[i].clear();
+				if (chunks[first + i].gap)
+				{
+					text[i] += "*\n";
+				}
+				stopped[i] = disasm_range(chunks[first + i].begin, chunks[first + i].end, text[i]);
+			}
+		};
+
+		vector<thread> pool;
+		for (unsigned t = 1; t < workers && t < count; t++)
+		{
+			pool.emplace_back(work);
+		}
+		work();
+		for (thread& t : pool)
+		{
+			t.join();
+		}
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			//A chunk is started at its first halfword, so if the last
+			//instruction before it ran into it, it is redone from after that
+			if (chunks[first + i].begin < resume)
+			{
+				text[i].clear();
+				stopped[i] = disasm_range(resume, chunks[first + i].end, text[i]);
+			}
+			resume = stopped[i];
+
+			cout.write(text[i].data(), text[i].size());
+		}
+	}
+
+	if (touched_only && gap_at_end)
+	{
+		cout << "*\n";
+	}
+
+	cout.flush();
+}
+
+//Characters insn_prefix writes
+static constexpr int insn_prefix_len = hex32_len + 2 + hex32_len + 2;
+
+/**
+ * Writes the address and encoded bytes that start each disassembly and -i
+ * line. A compressed instruction's 4 digits are padded out to line up with
+ * the 8 of the others.
+ *
+ * @param  buf: where to write, room for insn_prefix_len characters
+ * @param addr: address of the instruction
+ * @param insn: the instruction, only its low 16 bits if compressed
+ *
+ * @return: pointer just past the characters written
+ **/
+static char* insn_prefix(char* buf, uint32_t addr, uint32_t insn)
+{
+	char* p = hex32(buf, addr);
+	*p++ = ':';
+	*p++ = ' ';
+	if (is_compressed(insn))
+	{
+		p = hex16(p, insn);
+		memset(p, ' ', hex32_len - hex16_len);
+		p += hex32_len - hex16_len;
+	}
+	else
+	{
+		p = hex32(p, insn);
+	}
+	*p++ = ' ';
+	*p++ = ' ';
+	return p;
+}
+
+/**
+ * Appends the disassembly of the instructions from begin up to end, each
+ * taking 2 bytes if compressed and 4 otherwise
+ *
+ * @param begin: address of the first instruction
+ * @param   end: address to stop before
+ * @param   out: string to append the lines to
+ *
+ * @return: address just past the last instruction, which is end unless that
+ *          instruction ran past it
+ **/
+uint32_t rv32i::disasm_range(uint32_t begin, uint32_t end, std::string& out) const
+{
+	uint32_t addr = begin;
+	while (addr < end)
+	{
+		//Gets instruction bytes, a second halfword only if not compressed
+		//and it is in memory
+		uint32_t insn = mem->get16(addr);
+		uint32_t len = 2;
+		if (!is_compressed(insn))
+		{
+			len = 4;
+			if (addr + 2 < mem->get_size())
+			{
+				insn |= mem->get16(addr + 2) << 16;
+			}
+		}
+
+		//Address and encoded bytes
+		char prefix[insn_prefix_len];
+		out.append(prefix, insn_prefix(prefix, addr, insn) - prefix);
 
-		//Moves to next address
-		pc += 4;
+		//Decoded instruction
+		out += decode(insn, addr);
+		out += '\n';
+
+		addr += len;
 	}
+
+	return addr;
 }
 
 /**
  * Decodes the passed encoded instruction string and returns it
  *
- * @param insn: encoded instruction to be decoded
+ * @param insn: encoded instruction to be decoded, only the low 16 bits if it
+ *              is compressed
+ * @param addr: address of the instruction, for pc-relative targets
  *
  * @return: decoded instruction string
  **/
-string rv32i::decode(uint32_t insn) const
+string rv32i::decode(uint32_t insn, uint32_t addr) const
 {
+	//Compressed instructions are shown as what they expand to
+	if (is_compressed(insn))
+	{
+		insn = expand_compressed(insn);
+	}
+
 	//Extracts opcode, funct3, funct7 from instruction
 	uint32_t opcode = get_opcode(insn);
 	uint32_t funct3 = get_funct3(insn);
@@ -104,7 +401,7 @@ string rv32i::decode(uint32_t insn) const
 	case opcode_auipc:
 		return render_auipc(insn);
 	case opcode_jal:
-		return render_jal(insn);
+		return render_jal(insn, addr);
 	case opcode_jalr:
 		return render_jalr(insn);
 	case opcode_btype:
@@ -113,17 +410,17 @@ string rv32i::decode(uint32_t insn) const
 		default:
 			return render_illegal_insn();
 		case funct3_beq:
-			return render_btype(insn, "beq");
+			return render_btype(insn, addr, "beq");
 		case funct3_bne:
-			return render_btype(insn, "bne");
+			return render_btype(insn, addr, "bne");
 		case funct3_blt:
-			return render_btype(insn, "blt");
+			return render_btype(insn, addr, "blt");
 		case funct3_bge:
-			return render_btype(insn, "bge");
+			return render_btype(insn, addr, "bge");
 		case funct3_bltu:
-			return render_btype(insn, "bltu");
+			return render_btype(insn, addr, "bltu");
 		case funct3_bgeu:
-			return render_btype(insn, "bgeu");
+			return render_btype(insn, addr, "bgeu");
 		}
 	case opcode_itype_load:
 		switch (funct3)
@@ -171,19 +468,131 @@ string rv32i::decode(uint32_t insn) const
 		case funct3_andi:
 			return render_itype_alu(insn, "andi");
 		case funct3_slli:
+			if (funct7 == funct7_unary)
+			{
+				switch (get_rs2(insn))
+				{
+				default:
+					return render_illegal_insn();
+				case unary_clz:
+					return render_rtype_unary(insn, "clz");
+				case unary_ctz:
+					return render_rtype_unary(insn, "ctz");
+				case unary_cpop:
+					return render_rtype_unary(insn, "cpop");
+				case unary_sext_b:
+					return render_rtype_unary(insn, "sext.b");
+				case unary_sext_h:
+					return render_rtype_unary(insn, "sext.h");
+				}
+			}
 			return render_itype_alu_shamt(insn, "slli");
 		case funct3_sr:
 			switch (funct7)
 			{
 			default:
-				return render_illegal_insn();
+				switch (insn >> 20)
+				{
+				default:
+					return render_illegal_insn();
+				case imm_orc_b:
+					return render_rtype_unary(insn, "orc.b");
+				case imm_rev8:
+					return render_rtype_unary(insn, "rev8");
+				}
 			case funct7_srli:
 				return render_itype_alu_shamt(insn, "srli");
 			case funct7_srai:
 				return render_itype_alu_shamt(insn, "srai");
+			case funct7_rotate:
+				return render_itype_alu_shamt(insn, "rori");
 			}
 		}	
 	case opcode_rtype:
+		if (funct7 == funct7_muldiv)
+		{
+			switch (funct3)
+			{
+			default:
+				return render_illegal_insn();
+			case funct3_mul:
+				return render_rtype(insn, "mul");
+			case funct3_mulh:
+				return render_rtype(insn, "mulh");
+			case funct3_mulhsu:
+				return render_rtype(insn, "mulhsu");
+			case funct3_mulhu:
+				return render_rtype(insn, "mulhu");
+			case funct3_div:
+				return render_rtype(insn, "div");
+			case funct3_divu:
+				return render_rtype(insn, "divu");
+			case funct3_rem:
+				return render_rtype(insn, "rem");
+			case funct3_remu:
+				return render_rtype(insn, "remu");
+			}
+		}
+		switch (funct7)
+		{
+		default:
+			break;
+		case funct7_shadd:
+			switch (funct3)
+			{
+			default:
+				return render_illegal_insn();
+			case funct3_sh1add:
+				return render_rtype(insn, "sh1add");
+			case funct3_sh2add:
+				return render_rtype(insn, "sh2add");
+			case funct3_sh3add:
+				return render_rtype(insn, "sh3add");
+			}
+		case funct7_negated:
+			switch (funct3)
+			{
+			default:
+				break;
+			case funct3_and:
+				return render_rtype(insn, "andn");
+			case funct3_or:
+				return render_rtype(insn, "orn");
+			case funct3_xor:
+				return render_rtype(insn, "xnor");
+			}
+			break;
+		case funct7_minmax:
+			switch (funct3)
+			{
+			default:
+				return render_illegal_insn();
+			case funct3_min:
+				return render_rtype(insn, "min");
+			case funct3_minu:
+				return render_rtype(insn, "minu");
+			case funct3_max:
+				return render_rtype(insn, "max");
+			case funct3_maxu:
+				return render_rtype(insn, "maxu");
+			}
+		case funct7_zext_h:
+			if (funct3 == funct3_xor && get_rs2(insn) == 0)
+			{
+				return render_rtype_unary(insn, "zext.h");
+			}
+			return render_illegal_insn();
+		case funct7_rotate:
+			switch (funct3)
+			{
+			default:
+				return render_illegal_insn();
+			case funct3_sll:
+				return render_rtype(insn, "rol");
+			case funct3_sr2:
+				return render_rtype(insn, "ror");
+			}
+		}
 		switch (funct3)
 		{
 		default:
@@ -221,6 +630,40 @@ string rv32i::decode(uint32_t insn) const
 		case funct3_and:
 			return render_rtype(insn, "and");
 		}
+	case opcode_amo:
+		switch (funct3)
+		{
+		default:
+			return render_illegal_insn();
+		case funct3_amo_w:
+			switch (get_funct5(insn))
+			{
+			default:
+				return render_illegal_insn();
+			case funct5_lr:
+				return get_rs2(insn) == 0 ? render_amo(insn, "lr.w") : render_illegal_insn();
+			case funct5_sc:
+				return render_amo(insn, "sc.w");
+			case funct5_amoswap:
+				return render_amo(insn, "amoswap.w");
+			case funct5_amoadd:
+				return render_amo(insn, "amoadd.w");
+			case funct5_amoxor:
+				return render_amo(insn, "amoxor.w");
+			case funct5_amoand:
+				return render_amo(insn, "amoand.w");
+			case funct5_amoor:
+				return render_amo(insn, "amoor.w");
+			case funct5_amomin:
+				return render_amo(insn, "amomin.w");
+			case funct5_amomax:
+				return render_amo(insn, "amomax.w");
+			case funct5_amominu:
+				return render_amo(insn, "amominu.w");
+			case funct5_amomaxu:
+				return render_amo(insn, "amomaxu.w");
+			}
+		}
 	case opcode_fence:
 		return render_fence(insn);
 	case opcode_itype_spe:
@@ -346,6 +789,19 @@ static uint32_t get_funct7(uint32_t insn)
 	return funct3 & 0x0000007f;
 }
 
+/**
+ * Extracts the funct5 (bits 31-27) from passed atomic instruction
+ *
+ * @param insn: encoded instruction to get funct5 from
+ *
+ * @return: extracted funct5
+ **/
+static uint32_t get_funct5(uint32_t insn)
+{
+	//Shifts instruction bits 27 to the right, leaving only funct5
+	return insn >> 27;
+}
+
 /**
  * Extracts the imm (bits 31-12) from passed u-type instruction
  *
@@ -538,17 +994,18 @@ string rv32i::render_auipc(uint32_t insn) const
  * Decodes the jal instruction as a string
  *
  * @param insn: encoded instruction to decode
+ * @param addr: address of the instruction
  *
  * @return: decoded instruction string
  **/
-string rv32i::render_jal(uint32_t insn) const
+string rv32i::render_jal(uint32_t insn, uint32_t addr) const
 {
 	//Gets encoded components of instruction
 	uint32_t rd = get_rd(insn);
 	int32_t imm = get_imm_j(insn);
 	
 	//Gets relative imm
-	int32_t pcrel_21 = imm + pc;
+	int32_t pcrel_21 = imm + addr;
 
 	//Assembles components into decoded string
 	ostringstream os;
@@ -584,11 +1041,12 @@ string rv32i::render_jalr(uint32_t insn) const
  * Decodes b-type instruction as a string
  *
  * @param     insn: encoded instruction to decode
+ *            addr: address of the instruction
  *        mnemonic: mnemonic for specific instruction
  * 
  * @return: decoded instruction string
  **/
-string rv32i::render_btype(uint32_t insn, const char* mnemonic) const
+string rv32i::render_btype(uint32_t insn, uint32_t addr, const char* mnemonic) const
 {
 	//Gets encoded components of instruction
 	uint32_t rs1 = get_rs1(insn);
@@ -596,7 +1054,7 @@ string rv32i::render_btype(uint32_t insn, const char* mnemonic) const
 	int32_t imm = get_imm_b(insn);
 
 	//Gets relative imm
-	int32_t pcrel_13 = imm + pc;
+	int32_t pcrel_13 = imm + addr;
 
 	//Assembles components into decoded string
 	ostringstream os;
@@ -724,6 +1182,28 @@ string rv32i::render_rtype(uint32_t insn, const char* mnemonic) const
 	return os.str();
 }
 
+/**
+ * Decodes an r-type instruction that only reads rs1 as a string
+ *
+ * @param     insn: encoded instruction to decode
+ *        mnemonic: mnemonic for specific instruction
+ *
+ * @return: decoded instruction string
+ **/
+string rv32i::render_rtype_unary(uint32_t insn, const char* mnemonic) const
+{
+	//Gets encoded components of instruction
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+
+	//Assembles components into decoded string
+	ostringstream os;
+	os << setw(mnemonic_width) << setfill(' ') << left << mnemonic << "x" << dec << rd << ",x" << dec << rs1;
+
+	//Returns decoded string
+	return os.str();
+}
+
 /**
  * Decodes the fence instruction as a string
  *
@@ -782,6 +1262,50 @@ string rv32i::render_fence(uint32_t insn) const
 	return os.str();
 }
 
+/**
+ * Decodes an atomic memory instruction as a string, with .aq and .rl after
+ * the mnemonic when their bits are set
+ *
+ * @param     insn: encoded instruction to decode
+ *        mnemonic: mnemonic for specific instruction
+ *
+ * @return: decoded instruction string
+ **/
+string rv32i::render_amo(uint32_t insn, const char* mnemonic) const
+{
+	//Gets encoded components of instruction
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+
+	string name = mnemonic;
+	if (insn & amo_aq)
+	{
+		name += ".aq";
+	}
+	if (insn & amo_rl)
+	{
+		name += ".rl";
+	}
+
+	//Assembles components into decoded string, lr.w having no rs2
+	ostringstream os;
+	os << setw(mnemonic_width) << setfill(' ') << left << name;
+	if (name.size() >= mnemonic_width)
+	{
+		os << ' ';
+	}
+	os << "x" << dec << rd << ",";
+	if (get_funct5(insn) != funct5_lr)
+	{
+		os << "x" << rs2 << ",";
+	}
+	os << "(x" << rs1 << ")";
+
+	//Returns decoded string
+	return os.str();
+}
+
 /**
  * Decodes the ecall instruction as a string
  *
@@ -849,6 +1373,68 @@ void rv32i::set_has_insn_limit(bool b)
 	has_insn_limit = b;
 }
 
+/**
+ * Sets stack_top, the value the stack pointer (x2) starts at
+ *
+ * @param addr: what to set stack_top to
+ **/
+void rv32i::set_stack_top(uint32_t addr)
+{
+	stack_top = addr;
+}
+
+/**
+ * Sets trace_out, the binary trace each executed instruction is recorded to
+ *
+ * @param t: open trace writer, or nullptr to stop recording
+ **/
+void rv32i::set_trace_writer(trace_writer* t)
+{
+	trace_out = t;
+}
+
+/**
+ * Sets hart_id, the number mhartid reads as
+ *
+ * @param id: what to set hart_id to
+ **/
+void rv32i::set_hart_id(uint32_t id)
+{
+	hart_id = id;
+}
+
+/**
+ * Sets sys, which makes the system calls of ecall instructions instead of
+ * them halting
+ *
+ * @param s: system call emulator shared by every hart over this memory, or
+ *           nullptr to halt on ecall
+ **/
+void rv32i::set_syscalls(syscalls* s)
+{
+	sys = s;
+}
+
+/**
+ * Sets async_trace, which moves printing -i lines to a writer thread
+ *
+ * @param b: what to set async_trace to
+ **/
+void rv32i::set_async_trace(bool b)
+{
+	async_trace = b;
+}
+
+/**
+ * Sets use_jit
+ *
+ * @param b: what to set use_jit to
+ **/
+void rv32i::set_use_jit(bool b)
+{
+	use_jit = b;
+}
+
 /**
  * Returns value of halt
  * 
@@ -859,15 +1445,39 @@ bool rv32i::is_halted() const
 	return halt;
 }
 
+/**
+ * Returns whether the program ended itself with exit or exit_group
+ *
+ * @return value of exited
+ **/
+bool rv32i::has_exited() const
+{
+	return exited;
+}
+
+/**
+ * Returns the status the program passed to exit or exit_group
+ *
+ * @return value of exit_status
+ **/
+int32_t rv32i::get_exit_status() const
+{
+	return exit_status;
+}
+
 /**
  * Resets rv32i object and registerfile
  **/
 void rv32i::reset()
 {
 	//Resets rv32i object
-	pc = 0x0;
+	pc = mem->get_entry();
 	insn_counter = 0x0;
 	halt = false;
+	exited = false;
+	reserved = false;
+	mem->cancel_reservation(hart_id);
+	mscratch = 0;
 
 	//Resets registerfile
 	regs.reset();
@@ -883,237 +1493,527 @@ void rv32i::dump() const
 	regs.dump();
 
 	//Dumps pc reg
-	cout << setw(3) << setfill(' ') << right << "pc" << " " << hex << hex32(pc) << endl;
+	cout << setw(3) << setfill(' ') << right << "pc" << " " << hex32(pc) << endl;
 }
 
 /**
- * Decode and execute given instruction
- * 
- * @param insn: instruction to decode and execute
- * @param  pos: position of output stream
+ * Decodes given instruction into the handler that executes it and its
+ * already extracted register numbers and sign-extended immediate
+ *
+ * A compressed instruction is expanded first and decoded as the 32 bit
+ * instruction it stands for, so everything after this only sees its length.
+ *
+ * @param insn: instruction to decode, only the low 16 bits if compressed
+ * @param    d: decoded instruction to fill in
  **/
-void rv32i::dcex(uint32_t insn, ostream* pos)
+void rv32i::decode_insn(uint32_t insn, decoded_insn& d) const
 {
-	//Extracts opcode, funct3, funct7 from instruction
-	uint32_t opcode = get_opcode(insn);
-	uint32_t funct3 = get_funct3(insn);
-	uint32_t funct7 = get_funct7(insn);
+	d.len = 4;
+	d.cinsn = 0;
+	if (is_compressed(insn))
+	{
+		d.len = 2;
+		d.cinsn = insn;
+		insn = expand_compressed(insn);
+	}
 
-	//Returns instuction string based on opcode and instuction
-	switch (opcode)
+	//Extracts the fields shared by all formats
+	d.insn = insn;
+	d.imm = get_imm(insn);
+	d.rd = get_rd(insn);
+	d.rs1 = get_rs1(insn);
+	d.rs2 = get_rs2(insn);
+
+	//Looks up the handler for the operation
+	d.op = get_op(insn);
+	d.exec = exec_table[d.op];
+}
+
+/**
+ * Extracts the immediate of whichever format the passed instruction uses
+ *
+ * @param insn: encoded instruction to get imm from
+ *
+ * @return: sign-extended imm, or 0 if the format has none
+ **/
+static int32_t get_imm(uint32_t insn)
+{
+	switch (get_opcode(insn))
 	{
 	default:
-		exec_illegal_insn(insn, pos);
-		return;
+		return 0;
 	case opcode_lui:
-		exec_lui(insn, pos);
-		return;
 	case opcode_auipc:
-		exec_auipc(insn, pos);
-		return;
+		return get_imm_u(insn);
 	case opcode_jal:
-		exec_jal(insn, pos);
-		return;
+		return get_imm_j(insn);
 	case opcode_jalr:
-		exec_jalr(insn, pos);
-		return;
+	case opcode_itype_load:
+	case opcode_itype_alu:
+		return get_imm_i(insn);
+	case opcode_btype:
+		return get_imm_b(insn);
+	case opcode_stype:
+		return get_imm_s(insn);
+	}
+}
+
+/**
+ * Decodes the operation the passed instruction performs
+ *
+ * @param insn: encoded instruction to decode
+ *
+ * @return: operation, op_illegal_insn if not a valid instruction
+ **/
+static uint8_t get_op(uint32_t insn)
+{
+	//Extracts opcode, funct3, funct7 from instruction
+	uint32_t opcode = get_opcode(insn);
+	uint32_t funct3 = get_funct3(insn);
+	uint32_t funct7 = get_funct7(insn);
+
+	//Returns operation based on opcode and instuction
+	switch (opcode)
+	{
+	default:
+		return op_illegal_insn;
+	case opcode_lui:
+		return op_lui;
+	case opcode_auipc:
+		return op_auipc;
+	case opcode_jal:
+		return op_jal;
+	case opcode_jalr:
+		return op_jalr;
 	case opcode_btype:
 		switch (funct3)
 		{
 		default:
-			exec_illegal_insn(insn, pos);
-			return;
+			return op_illegal_insn;
 		case funct3_beq:
-			exec_beq(insn, pos);
-			return;
+			return op_beq;
 		case funct3_bne:
-			exec_bne(insn, pos);
-			return;
+			return op_bne;
 		case funct3_blt:
-			exec_blt(insn, pos);
-			return;
+			return op_blt;
 		case funct3_bge:
-			exec_bge(insn, pos);
-			return;
+			return op_bge;
 		case funct3_bltu:
-			exec_bltu(insn, pos);
-			return;
+			return op_bltu;
 		case funct3_bgeu:
-			exec_bgeu(insn, pos);
-			return;
+			return op_bgeu;
 		}
 	case opcode_itype_load:
 		switch (funct3)
 		{
 		default:
-			exec_illegal_insn(insn, pos);
-			return;
+			return op_illegal_insn;
 		case funct3_lb:
-			exec_lb(insn, pos);
-			return;
+			return op_lb;
 		case funct3_lh:
-			exec_lh(insn, pos);
-			return;
+			return op_lh;
 		case funct3_lw:
-			exec_lw(insn, pos);
-			return;
+			return op_lw;
 		case funct3_lbu:
-			exec_lbu(insn, pos);
-			return;
+			return op_lbu;
 		case funct3_lhu:
-			exec_lhu(insn, pos);
-			return;
+			return op_lhu;
 		}
 	case opcode_stype:
 		switch (funct3)
 		{
 		default:
-			exec_illegal_insn(insn, pos);
-			return;
+			return op_illegal_insn;
 		case funct3_sb:
-			exec_sb(insn, pos);
-			return;
+			return op_sb;
 		case funct3_sh:
-			exec_sh(insn, pos);
-			return;
+			return op_sh;
 		case funct3_sw:
-			exec_sw(insn, pos);
-			return;
+			return op_sw;
 		}
 	case opcode_itype_alu:
 		switch (funct3)
 		{
 		default:
-			exec_illegal_insn(insn, pos);
-			return;
+			return op_illegal_insn;
 		case funct3_addi:
-			exec_addi(insn, pos);
-			return;
+			return op_addi;
 		case funct3_slti:
-			exec_slti(insn, pos);
-			return;
+			return op_slti;
 		case funct3_sltiu:
-			exec_sltiu(insn, pos);
-			return;
+			return op_sltiu;
 		case funct3_xori:
-			exec_xori(insn, pos);
-			return;
+			return op_xori;
 		case funct3_ori:
-			exec_ori(insn, pos);
-			return;
+			return op_ori;
 		case funct3_andi:
-			exec_andi(insn, pos);
-			return;
+			return op_andi;
 		case funct3_slli:
-			exec_slli(insn, pos);
-			return;
+			if (funct7 == funct7_unary)
+			{
+				switch (get_rs2(insn))
+				{
+				default:
+					return op_illegal_insn;
+				case unary_clz:
+					return op_clz;
+				case unary_ctz:
+					return op_ctz;
+				case unary_cpop:
+					return op_cpop;
+				case unary_sext_b:
+					return op_sext_b;
+				case unary_sext_h:
+					return op_sext_h;
+				}
+			}
+			return op_slli;
 		case funct3_sr:
 			switch (funct7)
 			{
 			default:
-				exec_illegal_insn(insn, pos);
-				return;
+				switch (insn >> 20)
+				{
+				default:
+					return op_illegal_insn;
+				case imm_orc_b:
+					return op_orc_b;
+				case imm_rev8:
+					return op_rev8;
+				}
 			case funct7_srli:
-				exec_srli(insn, pos);
-				return;
+				return op_srli;
 			case funct7_srai:
-				exec_srai(insn, pos);
-				return;
+				return op_srai;
+			case funct7_rotate:
+				return op_rori;
 			}
 		}
 	case opcode_rtype:
+		if (funct7 == funct7_muldiv)
+		{
+			switch (funct3)
+			{
+			default:
+				return op_illegal_insn;
+			case funct3_mul:
+				return op_mul;
+			case funct3_mulh:
+				return op_mulh;
+			case funct3_mulhsu:
+				return op_mulhsu;
+			case funct3_mulhu:
+				return op_mulhu;
+			case funct3_div:
+				return op_div;
+			case funct3_divu:
+				return op_divu;
+			case funct3_rem:
+				return op_rem;
+			case funct3_remu:
+				return op_remu;
+			}
+		}
+		switch (funct7)
+		{
+		default:
+			break;
+		case funct7_shadd:
+			switch (funct3)
+			{
+			default:
+				return op_illegal_insn;
+			case funct3_sh1add:
+				return op_sh1add;
+			case funct3_sh2add:
+				return op_sh2add;
+			case funct3_sh3add:
+				return op_sh3add;
+			}
+		case funct7_negated:
+			switch (funct3)
+			{
+			default:
+				break;
+			case funct3_and:
+				return op_andn;
+			case funct3_or:
+				return op_orn;
+			case funct3_xor:
+				return op_xnor;
+			}
+			break;
+		case funct7_minmax:
+			switch (funct3)
+			{
+			default:
+				return op_illegal_insn;
+			case funct3_min:
+				return op_min;
+			case funct3_minu:
+				return op_minu;
+			case funct3_max:
+				return op_max;
+			case funct3_maxu:
+				return op_maxu;
+			}
+		case funct7_zext_h:
+			if (funct3 == funct3_xor && get_rs2(insn) == 0)
+			{
+				return op_zext_h;
+			}
+			return op_illegal_insn;
+		case funct7_rotate:
+			switch (funct3)
+			{
+			default:
+				return op_illegal_insn;
+			case funct3_sll:
+				return op_rol;
+			case funct3_sr2:
+				return op_ror;
+			}
+		}
 		switch (funct3)
 		{
 		default:
-			exec_illegal_insn(insn, pos);
-			return;
+			return op_illegal_insn;
 		case funct3_addsub:
 			switch (funct7)
 			{
 			default:
-				exec_illegal_insn(insn, pos);
-				return;
+				return op_illegal_insn;
 			case funct7_add:
-				exec_add(insn, pos);
-				return;
+				return op_add;
 			case funct7_sub:
-				exec_sub(insn, pos);
-				return;
+				return op_sub;
 			}
 		case funct3_sll:
-			exec_sll(insn, pos);
-			return;
+			return op_sll;
 		case funct3_slt:
-			exec_slt(insn, pos);
-			return;
+			return op_slt;
 		case funct3_sltu:
-			exec_sltu(insn, pos);
-			return;
+			return op_sltu;
 		case funct3_xor:
-			exec_xor(insn, pos);
-			return;
+			return op_xor;
 		case funct3_sr2:
 			switch (funct7)
 			{
 			default:
-				exec_illegal_insn(insn, pos);
-				return;
+				return op_illegal_insn;
 			case funct7_srl:
-				exec_srl(insn, pos);
-				return;
+				return op_srl;
 			case funct7_sra:
-				exec_sra(insn, pos);
-				return;
+				return op_sra;
 			}
 		case funct3_or:
-			exec_or(insn, pos);
-			return;
+			return op_or;
 		case funct3_and:
-			exec_and(insn, pos);
-			return;
+			return op_and;
+		}
+	case opcode_amo:
+		//lr.w has no rs2, anything else there is not an instruction
+		if (funct3 != funct3_amo_w || (get_funct5(insn) == funct5_lr && get_rs2(insn) != 0))
+		{
+			return op_illegal_insn;
+		}
+		switch (get_funct5(insn))
+		{
+		default:
+			return op_illegal_insn;
+		case funct5_lr:
+			return op_lr_w;
+		case funct5_sc:
+			return op_sc_w;
+		case funct5_amoswap:
+			return op_amoswap_w;
+		case funct5_amoadd:
+			return op_amoadd_w;
+		case funct5_amoxor:
+			return op_amoxor_w;
+		case funct5_amoand:
+			return op_amoand_w;
+		case funct5_amoor:
+			return op_amoor_w;
+		case funct5_amomin:
+			return op_amomin_w;
+		case funct5_amomax:
+			return op_amomax_w;
+		case funct5_amominu:
+			return op_amominu_w;
+		case funct5_amomaxu:
+			return op_amomaxu_w;
 		}
 	case opcode_fence:
-		exec_fence(insn, pos);
-		return;
+		return op_fence;
 	case opcode_itype_spe:
 		switch (funct3)
 		{
 		default:
-			exec_illegal_insn(insn, pos);
-			return;
+			return op_illegal_insn;
 		case funct3_ecallbreak:
 			switch (insn)
 			{
 			default:
-				exec_illegal_insn(insn, pos);
-				return;
+				return op_illegal_insn;
 			case insn_ecall:
-				exec_ecall(insn, pos);
-				return;
+				return op_ecall;
 			case insn_ebreak:
-				exec_ebreak(insn, pos);
-				return;
+				return op_ebreak;
 			}
 		case funct3_csrrw:
-			exec_csrrw(insn, pos);
-			return;
+			return op_csrrw;
 		case funct3_csrrs:
-			exec_csrrs(insn, pos);
-			return;
+			return op_csrrs;
 		case funct3_csrrc:
-			exec_csrrc(insn, pos);
-			return;
+			return op_csrrc;
 		case funct3_csrrwi:
-			exec_csrrwi(insn, pos);
-			return;
+			return op_csrrwi;
 		case funct3_csrrsi:
-			exec_csrrsi(insn, pos);
-			return;
+			return op_csrrsi;
 		case funct3_csrrci:
-			exec_csrrci(insn, pos);
-			return;
+			return op_csrrci;
+		}
+	}
+}
+
+/**
+ * Decode and execute given instruction
+ * 
+ * @param insn: instruction to decode and execute
+ * @param  pos: position of output stream
+ **/
+void rv32i::dcex(uint32_t insn, ostream* pos)
+{
+	decoded_insn d;
+	decode_insn(insn, d);
+
+	(this->*d.exec)(d, pos);
+}
+
+/**
+ * Reads the instruction at the given address: just its first halfword if it
+ * is compressed, otherwise both
+ *
+ * @param addr: address of the instruction
+ *
+ * @return: the instruction
+ **/
+uint32_t rv32i::read_insn(uint32_t addr) const
+{
+	uint32_t insn = mem->get16(addr);
+	if (!is_compressed(insn))
+	{
+		insn |= mem->get16(addr + 2) << 16;
+	}
+	return insn;
+}
+
+/**
+ * Tells whether the hart stopped on an ebreak, either size of it, without
+ * caching its decode
+ *
+ * @return: true if the instruction at pc is ebreak or c.ebreak
+ **/
+bool rv32i::at_ebreak() const
+{
+	decoded_insn d;
+	decode_insn(read_insn(pc), d);
+	return d.op == op_ebreak;
+}
+
+/**
+ * Returns the decoded instruction at the given address, decoding and caching
+ * it first if it has not been seen since its memory was last written
+ *
+ * Only halfword aligned addresses inside memory are cached; anything else is
+ * decoded on every call. So is a 32 bit instruction that starts at the end
+ * of one page and runs into the next, as only its first page's decodes are
+ * dropped when code is written, though both pages are watched so blocks
+ * holding it are.
+ *
+ * @param addr: address of the instruction
+ * @param    d: decoded instruction to fill in
+ **/
+void rv32i::fetch(uint32_t addr, decoded_insn& d)
+{
+	uint32_t page = addr >> memory::page_shift;
+
+	//Decodes uncached if address can not be held in the cache
+	if ((addr & 1) != 0 || addr >= mem->get_size())
+	{
+		decode_insn(read_insn(addr), d);
+		return;
+	}
+	if ((addr & (memory::page_size - 1)) == memory::page_size - 2 && addr + 2 < mem->get_size() && !is_compressed(mem->get16(addr)))
+	{
+		mem->watch_code(addr);
+		mem->watch_code(addr + 2);
+		decode_insn(read_insn(addr), d);
+		return;
+	}
+
+	//Allocates the page's cache on first use
+	decoded_insn* entries = dcache[page];
+	if (entries == nullptr)
+	{
+		entries = new decoded_insn[dcache_page_entries]();
+		dcache[page] = entries;
+	}
+
+	//Asks memory to report writes over it, then decodes it, if not already
+	//cached. In that order a write by another hart can not slip in between.
+	decoded_insn& entry = entries[(addr & (memory::page_size - 1)) >> 1];
+	if (entry.exec == nullptr)
+	{
+		mem->watch_code(addr);
+		decode_insn(read_insn(addr), entry);
+	}
+
+	d = entry;
+}
+
+/**
+ * Notes that a page of memory holding cached decodes was written
+ *
+ * Any hart sharing memory may be the one writing, from its own thread, so
+ * the decodes and blocks are only freed by drop_stale_code once this hart is
+ * between instructions.
+ *
+ * @param page: number of the page that was written
+ **/
+void rv32i::code_modified(uint32_t page)
+{
+	lock_guard<mutex> lock(stale_lock);
+	stale_pages.push_back(page);
+	blocks_stale = true;
+}
+
+/**
+ * Throws away the cached decodes of every page written since the last time,
+ * then every basic block
+ **/
+void rv32i::drop_stale_code()
+{
+	//Cleared first, so a write landing while this runs is caught next time
+	blocks_stale = false;
+
+	vector<uint32_t> written;
+	{
+		lock_guard<mutex> lock(stale_lock);
+		written.swap(stale_pages);
+	}
+
+	for (uint32_t page : written)
+	{
+		if (page < dcache.size())
+		{
+			delete[] dcache[page];
+			dcache[page] = nullptr;
 		}
 	}
+
+	flush_blocks();
 }
 
 /**
@@ -1137,1173 +2037,3868 @@ void rv32i::tick()
 		dump();
 	}
 
-	//Gets instruction to run
-	uint32_t insn = mem->get32(pc);
-
-	if (show_instructions)
+	//Gets instruction to run, decoded once per address
+	if (blocks_stale)
 	{
-		//Print address
-		cout << setw(8) << setfill('0') << hex32(pc) << ": ";
+		drop_stale_code();
+	}
+	decoded_insn d;
+	fetch(pc, d);
+
+	//Source registers are read before the instruction can change them
+	uint32_t addr = pc;
+	int32_t rs1val = regs.get(d.rs1);
+	int32_t rs2val = regs.get(d.rs2);
 
-		//Prints encoded bytes
-		cout << setw(8) << setfill('0') << hex << static_cast<int>(insn) << "  " << dec;
+	if (show_instructions && trace_ring == nullptr)
+	{
+		//Prints address and encoded bytes
+		print_insn_prefix(pc, d);
 		
 		//Prints instruction before executing if flag set
-		dcex(insn, &std::cout);
+		(this->*d.exec)(d, &std::cout);
 	}
 
 	else
 	{
 		//Silently executes
-		dcex(insn, nullptr);
+		(this->*d.exec)(d, nullptr);
+	}
+
+	if (trace_out || trace_ring)
+	{
+		trace_record r;
+		record_insn(r, d, addr, rs1val, rs2val);
+
+		if (trace_out)
+		{
+			trace_out->record(r);
+		}
+
+		//Hands the line to the writer thread to print
+		if (trace_ring)
+		{
+			trace_ring->push(r);
+		}
 	}
 }
 
 /**
- * Runs the rv32i simulation for all instructions in limit
- * 
- * @param limit: max instructions to run
+ * Prints the address and encoded bytes that start each -i line
+ *
+ * @param addr: address of the instruction
+ * @param    d: the instruction
  **/
-void rv32i::run(uint64_t limit)
+void rv32i::print_insn_prefix(uint32_t addr, const decoded_insn& d) const
 {
-	//Sets register 2 to memory size
-	regs.set(2, mem->get_size());
+	char prefix[insn_prefix_len];
+	cout.write(prefix, insn_prefix(prefix, addr, d.len == 2 ? d.cinsn : d.insn) - prefix);
+}
 
-	//Goes through simulation 1 instruction at a time until halted or limit reached
-	while (halt != true && (insn_counter != limit || has_insn_limit == false))
+/**
+ * Fills in the trace record of an instruction that was just executed
+ *
+ * @param      r: record to fill in
+ * @param      d: the instruction
+ * @param   addr: where it was
+ * @param rs1val: rs1 before it ran
+ * @param rs2val: rs2 before it ran
+ **/
+void rv32i::record_insn(trace_record& r, const decoded_insn& d, uint32_t addr, int32_t rs1val, int32_t rs2val) const
+{
+	r.pc = addr;
+	r.insn = d.len == 2 ? d.cinsn : d.insn;
+	r.has_rd = false;
+	r.rd_val = 0;
+	r.has_mem = false;
+	r.mem_addr = rs1val + d.imm;
+	r.mem_val = 0;
+
+	switch (d.op)
 	{
-		tick();
+	default:
+		break;
+
+	case op_lb:
+	case op_lbu:
+		r.has_mem = true;
+		r.mem_val = mem->peek8(r.mem_addr);
+		break;
+	case op_lh:
+	case op_lhu:
+		r.has_mem = true;
+		r.mem_val = mem->peek8(r.mem_addr) | (mem->peek8(r.mem_addr + 1) << 8);
+		break;
+	case op_lw:
+		r.has_mem = true;
+		r.mem_val = mem->peek32(r.mem_addr);
+		break;
+	case op_sb:
+		r.has_mem = true;
+		r.mem_val = rs2val & 0xff;
+		break;
+	case op_sh:
+		r.has_mem = true;
+		r.mem_val = rs2val & 0xffff;
+		break;
+	case op_sw:
+		r.has_mem = true;
+		r.mem_val = rs2val;
+		break;
+	case op_lr_w:
+	case op_sc_w:
+	case op_amoswap_w:
+	case op_amoadd_w:
+	case op_amoxor_w:
+	case op_amoand_w:
+	case op_amoor_w:
+	case op_amomin_w:
+	case op_amomax_w:
+	case op_amominu_w:
+	case op_amomaxu_w:
+		r.has_mem = true;
+		r.mem_val = amo_loaded;
+		break;
 	}
 
-	//Prints message if ended with ebreak instruction
-	if (mem->get32(pc) == insn_ebreak)
+	//Everything that can write rd
+	switch (d.op)
 	{
-		cout << "Execution terminated by EBREAK instruction" << endl;
+	case op_lui:
+	case op_auipc:
+	case op_jal:
+	case op_jalr:
+	case op_lb:
+	case op_lh:
+	case op_lw:
+	case op_lbu:
+	case op_lhu:
+	case op_addi:
+	case op_slti:
+	case op_sltiu:
+	case op_xori:
+	case op_ori:
+	case op_andi:
+	case op_slli:
+	case op_srli:
+	case op_srai:
+	case op_add:
+	case op_sub:
+	case op_sll:
+	case op_slt:
+	case op_sltu:
+	case op_xor:
+	case op_srl:
+	case op_sra:
+	case op_or:
+	case op_and:
+	case op_mul:
+	case op_mulh:
+	case op_mulhsu:
+	case op_mulhu:
+	case op_div:
+	case op_divu:
+	case op_rem:
+	case op_remu:
+	case op_sh1add:
+	case op_sh2add:
+	case op_sh3add:
+	case op_andn:
+	case op_orn:
+	case op_xnor:
+	case op_clz:
+	case op_ctz:
+	case op_cpop:
+	case op_max:
+	case op_maxu:
+	case op_min:
+	case op_minu:
+	case op_sext_b:
+	case op_sext_h:
+	case op_zext_h:
+	case op_rol:
+	case op_ror:
+	case op_rori:
+	case op_orc_b:
+	case op_rev8:
+	case op_lr_w:
+	case op_amoswap_w:
+	case op_amoadd_w:
+	case op_amoxor_w:
+	case op_amoand_w:
+	case op_amoor_w:
+	case op_amomin_w:
+	case op_amomax_w:
+	case op_amominu_w:
+	case op_amomaxu_w:
+		r.has_rd = d.rd != 0;
+		r.rd_val = regs.get(d.rd);
+		break;
+
+	//a0, for a system call made in place of halting
+	case op_ecall:
+		r.has_rd = sys != nullptr;
+		r.rd_val = regs.get(10);
+		break;
+
+	//Kept even for x0, so a replay stores or not as sc.w did here
+	case op_sc_w:
+		r.has_rd = !halt;
+		r.rd_val = sc_stored ? 0 : 1;
+		break;
+
+	//Kept even for x0, so a replay reads the CSR as it was read here
+	case op_csrrw:
+	case op_csrrs:
+	case op_csrrc:
+	case op_csrrwi:
+	case op_csrrsi:
+	case op_csrrci:
+		r.has_rd = !halt;
+		r.rd_val = csr_read;
+		break;
+	default:
+		break;
 	}
-
-	//Prints number of instructions executed
-	cout << to_string(insn_counter) << " instructions executed" << endl;
 }
 
 /**
- * Terminates simulation by setting halt flag and renders error message if needed
+ * Returns the decoded instruction at the given address straight out of the
+ * decode cache when it is there, otherwise decodes it through fetch
+ *
+ * @param addr: address of the instruction
+ * @param  tmp: storage for the decode when it is not in the cache
+ *
+ * @return: pointer to the decoded instruction
  **/
-void rv32i::exec_illegal_insn(uint32_t insn, std::ostream* pos)
+inline const decoded_insn* rv32i::lookup(uint32_t addr, decoded_insn& tmp)
 {
-	halt = true;
+	uint32_t page = addr >> memory::page_shift;
 
-	if (pos)
+	if ((addr & 1) == 0 && page < dcache.size() && dcache[page] != nullptr)
 	{
-		render_illegal_insn();
+		const decoded_insn* entry = &dcache[page][(addr & (memory::page_size - 1)) >> 1];
+		if (entry->exec != nullptr)
+		{
+			return entry;
+		}
 	}
+
+	fetch(addr, tmp);
+	return &tmp;
 }
 
 /**
- * Simulates instruction execution and renders instuction if render flag set
- * 
- * @param insn: instruction to execute and render
- * @param  pos: position of output stream
+ * Tells whether the passed operation must be the last one of a basic block:
+ * anything that can send pc anywhere but the next instruction, and anything
+ * the fast engine hands to its exec_* function
+ *
+ * @param op: operation to check
+ *
+ * @return: true if the operation ends a block
  **/
-void rv32i::exec_lui(uint32_t insn, std::ostream* pos)
+static bool ends_block(uint8_t op)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t imm = get_imm_u(insn);
-
-	if (pos)
+	switch (op)
 	{
-		std::string s = render_lui(insn);
-		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(imm) << endl;
+	default:
+		return true;
+	case op_lui:
+	case op_auipc:
+	case op_lb:
+	case op_lh:
+	case op_lw:
+	case op_lbu:
+	case op_lhu:
+	case op_sb:
+	case op_sh:
+	case op_sw:
+	case op_addi:
+	case op_slti:
+	case op_sltiu:
+	case op_xori:
+	case op_ori:
+	case op_andi:
+	case op_slli:
+	case op_srli:
+	case op_srai:
+	case op_add:
+	case op_sub:
+	case op_sll:
+	case op_slt:
+	case op_sltu:
+	case op_xor:
+	case op_srl:
+	case op_sra:
+	case op_or:
+	case op_and:
+	case op_mul:
+	case op_mulh:
+	case op_mulhsu:
+	case op_mulhu:
+	case op_div:
+	case op_divu:
+	case op_rem:
+	case op_remu:
+	case op_sh1add:
+	case op_sh2add:
+	case op_sh3add:
+	case op_andn:
+	case op_orn:
+	case op_xnor:
+	case op_clz:
+	case op_ctz:
+	case op_cpop:
+	case op_max:
+	case op_maxu:
+	case op_min:
+	case op_minu:
+	case op_sext_b:
+	case op_sext_h:
+	case op_zext_h:
+	case op_rol:
+	case op_ror:
+	case op_rori:
+	case op_orc_b:
+	case op_rev8:
+	case op_fence:
+		return false;
 	}
-
-	regs.set(rd, imm);
-	pc += 4;
 }
 
 /**
- * Simulates instruction execution and renders instuction if render flag set
+ * Decodes the basic block starting at the given address
  *
- * @param insn: instruction to execute and render
- * @param  pos: position of output stream
+ * The block runs up to and including the first instruction that ends_block,
+ * and is also cut at block_max_insns instructions, at the end of the page
+ * and at the end of memory.
+ *
+ * @param addr: address of the first instruction, halfword aligned and in memory
+ *
+ * @return: the new block
  **/
-void rv32i::exec_auipc(uint32_t insn, std::ostream* pos)
+basic_block* rv32i::translate_block(uint32_t addr)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t imm = get_imm_u(insn);
-	
-	int32_t val = pc + imm;
+	basic_block* b = new basic_block();
+	b->start = addr;
 
-	if (pos)
+	//Decodes instructions until one ends the block or a limit is reached
+	decoded_insn d;
+	uint32_t last_pc;
+	do
 	{
-		std::string s = render_auipc(insn);
-		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(pc) << " + " << hex0x32(imm) << " = " << hex0x32(val) << endl;
+		fetch(addr, d);
+		b->ops.push_back(d);
+		last_pc = addr;
+		addr += d.len;
+	} while (!ends_block(d.op) && b->ops.size() < block_max_insns && (addr >> memory::page_shift) == (b->start >> memory::page_shift) && addr < mem->get_size());
+
+	b->count = b->ops.size();
+	b->end = addr;
+
+	//Records where execution can go next so those blocks can be chained
+	b->succ_pc[0] = no_successor;
+	b->succ_pc[1] = no_successor;
+	switch (d.op)
+	{
+	default:
+		b->succ_pc[0] = addr;
+		break;
+	case op_beq:
+	case op_bne:
+	case op_blt:
+	case op_bge:
+	case op_bltu:
+	case op_bgeu:
+		b->succ_pc[0] = last_pc + d.imm;
+		b->succ_pc[1] = addr;
+		break;
+	case op_jal:
+		b->succ_pc[0] = last_pc + d.imm;
+		break;
+	case op_jalr:
+		break;
 	}
 
-	regs.set(rd, val);
-	pc += 4;
+	//Marks the end so the engine knows to pick the next block
+	decoded_insn end = {};
+	end.op = op_block_end;
+	b->ops.push_back(end);
+
+	return b;
 }
 
 /**
- * Simulates instruction execution and renders instuction if render flag set
+ * Returns the basic block starting at the given address, translating it
+ * first if it is not in the block cache
  *
- * @param insn: instruction to execute and render
- * @param  pos: position of output stream
+ * @param addr: address of the first instruction
+ *
+ * @return: the block, or nullptr if addr is not halfword aligned or not in memory
  **/
-void rv32i::exec_jal(uint32_t insn, std::ostream* pos)
+basic_block* rv32i::get_block(uint32_t addr)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t imm = get_imm_j(insn);
-	
-	int32_t pcrel_21 = imm + pc;
-	int32_t val = pc + 4;
+	if ((addr & 1) != 0 || addr >= mem->get_size())
+	{
+		return nullptr;
+	}
 
-	if (pos)
+	//Allocates the page's block table on first use
+	basic_block**& blocks = bcache[addr >> memory::page_shift];
+	if (blocks == nullptr)
 	{
-		std::string s = render_jal(insn);
-		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(val) << ",  " << "pc = " << hex0x32(pc) << " + " << hex0x32(imm) << " = " << hex0x32(pcrel_21) << endl;
+		blocks = new basic_block*[dcache_page_entries]();
 	}
 
-	regs.set(rd, val);
-	pc = pcrel_21;
+	basic_block*& b = blocks[(addr & (memory::page_size - 1)) >> 1];
+	if (b == nullptr)
+	{
+		b = translate_block(addr);
+	}
+
+	return b;
 }
 
 /**
- * Simulates instruction execution and renders instuction if render flag set
- *
- * @param insn: instruction to execute and render
- * @param  pos: position of output stream
+ * Throws away every decoded instruction and basic block and sizes the
+ * caches to match memory again
  **/
-void rv32i::exec_jalr(uint32_t insn, std::ostream* pos)
+void rv32i::reset_caches()
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t imm = get_imm_i(insn);
-	uint32_t rs1 = get_rs1(insn);
-	
-	int32_t rs1val = regs.get(rs1);
-	int32_t val = pc + 4;
-	int32_t val2 = (imm + rs1val) & 0xfffffffe;
-
-	if (pos)
+	drop_stale_code();
+	for (decoded_insn* entries : dcache)
 	{
-		std::string s = render_jalr(insn);
-		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(val) << ",  " << "pc = (" << hex0x32(imm) << " + " << hex0x32(rs1val) << ") & 0xfffffffe = " << hex0x32(val2) << endl;
+		delete[] entries;
 	}
+	flush_blocks();
 
-	regs.set(rd, val);
-	pc = val2;
+	dcache.assign((mem->get_size() + memory::page_size - 1) >> memory::page_shift, nullptr);
+	bcache.assign(dcache.size(), nullptr);
 }
 
 /**
- * Simulates instruction execution and renders instuction if render flag set
- *
- * @param insn: instruction to execute and render
- * @param  pos: position of output stream
+ * Frees every basic block. Blocks are chained across pages, so when any
+ * code changes they are all thrown away together.
  **/
-void rv32i::exec_beq(uint32_t insn, std::ostream* pos)
+void rv32i::flush_blocks()
 {
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-	int32_t imm = get_imm_b(insn);
-
-	int32_t rs1val = regs.get(rs1);
-	int32_t rs2val = regs.get(rs2);
-
-	int32_t val = (rs1val == rs2val) ? imm : 4;
-	int32_t val2 = pc + val;
-
-	if (pos)
+	for (basic_block**& blocks : bcache)
 	{
-		std::string s = render_btype(insn, "beq");
-		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "pc += (" << hex0x32(rs1val) << " == " << hex0x32(rs2val) << " ? " << hex0x32(imm) << " : 4) = " << hex0x32(val2) << endl;
+		if (blocks != nullptr)
+		{
+			for (uint32_t i = 0; i < dcache_page_entries; i++)
+			{
+				delete blocks[i];
+			}
+			delete[] blocks;
+			blocks = nullptr;
+		}
 	}
 
-	pc = val2;
+	compiler.reset();
 }
 
+//GCC and Clang can jump straight from one handler to the next (threaded code),
+//anything else falls back to a switch in a loop
+#if defined(__GNUC__)
+#define FAST_THREADED
+#endif
+
+#ifdef FAST_THREADED
+#define FAST_OP(name)     L_##name:
+#define FAST_SLOW         L_slow:
+#define FAST_DISPATCH()   goto *labels[d->op]
+#else
+#define FAST_OP(name)     case op_##name:
+#define FAST_SLOW         default:
+#define FAST_DISPATCH()   continue
+#endif
+
+#define FAST_NEXT()       ++d; FAST_DISPATCH()
+#define FAST_STORE_NEXT() if (blocks_stale) { goto code_changed; } FAST_NEXT()
+
 /**
- * Simulates instruction execution and renders instuction if render flag set
+ * Runs the simulation without any tracing, one basic block at a time
  *
- * @param insn: instruction to execute and render
- * @param  pos: position of output stream
+ * Used by run when neither instructions nor registers are shown, so none of
+ * the per-instruction output checks of tick and the exec_* functions are
+ * paid. Each block is counted against the limit as a whole when it enters;
+ * if the limit lands inside the next block, instructions are run one at a
+ * time instead so it stops exactly. Blocks are chained to the blocks that
+ * follow their branches, so the block cache is only searched on the first
+ * pass through a branch and after indirect jumps. Blocks entered often enough
+ * are compiled to native code when use_jit is set. Anything without a handler
+ * here (ecall, ebreak, illegal, csr*) goes through its normal exec_* function.
+ *
+ * @param limit: max instructions to run, if has_insn_limit is set
  **/
-void rv32i::exec_bne(uint32_t insn, std::ostream* pos)
+void rv32i::run_fast(uint64_t limit)
 {
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-	int32_t imm = get_imm_b(insn);
+	int32_t* x = regs.data();
+	uint32_t cur_pc = pc;
+	uint64_t count = insn_counter;
+	uint64_t stop = has_insn_limit ? limit : UINT64_MAX;
 
-	int32_t rs1val = regs.get(rs1);
-	int32_t rs2val = regs.get(rs2);
+	//Block being run, or nullptr when stepping one instruction at a time
+	basic_block* b = nullptr;
 
-	int32_t val = (rs1val != rs2val) ? imm : 4;
-	int32_t val2 = pc + val;
+	//A single instruction followed by an end marker, for stepping
+	decoded_insn step[2] = {};
+	step[1].op = op_block_end;
 
-	if (pos)
+	decoded_insn tmp;
+	const decoded_insn* d = &step[1];
+
+	//What compiled blocks work on
+	jit_context ctx;
+	ctx.regs = x;
+	ctx.mem = mem;
+	ctx.stale = &blocks_stale;
+
+#ifdef FAST_THREADED
+	static const void* const labels[op_count + 1] =
 	{
-		std::string s = render_btype(insn, "bne");
+		&&L_slow,
+		&&L_lui,
+		&&L_auipc,
+		&&L_jal,
+		&&L_jalr,
+		&&L_beq,
+		&&L_bne,
+		&&L_blt,
+		&&L_bge,
+		&&L_bltu,
+		&&L_bgeu,
+		&&L_lb,
+		&&L_lh,
+		&&L_lw,
+		&&L_lbu,
+		&&L_lhu,
+		&&L_sb,
+		&&L_sh,
+		&&L_sw,
+		&&L_addi,
+		&&L_slti,
+		&&L_sltiu,
+		&&L_xori,
+		&&L_ori,
+		&&L_andi,
+		&&L_slli,
+		&&L_srli,
+		&&L_srai,
+		&&L_add,
+		&&L_sub,
+		&&L_sll,
+		&&L_slt,
+		&&L_sltu,
+		&&L_xor,
+		&&L_srl,
+		&&L_sra,
+		&&L_or,
+		&&L_and,
+		&&L_mul,
+		&&L_mulh,
+		&&L_mulhsu,
+		&&L_mulhu,
+		&&L_div,
+		&&L_divu,
+		&&L_rem,
+		&&L_remu,
+		&&L_sh1add,
+		&&L_sh2add,
+		&&L_sh3add,
+		&&L_andn,
+		&&L_orn,
+		&&L_xnor,
+		&&L_clz,
+		&&L_ctz,
+		&&L_cpop,
+		&&L_max,
+		&&L_maxu,
+		&&L_min,
+		&&L_minu,
+		&&L_sext_b,
+		&&L_sext_h,
+		&&L_zext_h,
+		&&L_rol,
+		&&L_ror,
+		&&L_rori,
+		&&L_orc_b,
+		&&L_rev8,
+		&&L_fence,
+		&&L_slow,
+		&&L_slow,
+		&&L_slow,
+		&&L_slow,
+		&&L_slow,
+		&&L_slow,
+		&&L_slow,
+		&&L_slow,
+		&&L_slow,
+		&&L_slow,
+		&&L_slow,
+		&&L_slow,
+		&&L_slow,
+		&&L_slow,
+		&&L_slow,
+		&&L_slow,
+		&&L_slow,
+		&&L_slow,
+		&&L_slow,
+		&&L_block_end,
+	};
+
+	FAST_DISPATCH();
+#else
+	for (;;)
+	{
+		switch (d->op)
+		{
+#endif
+	FAST_OP(lui)
+		x[d->rd] = d->imm;
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(auipc)
+		x[d->rd] = cur_pc + d->imm;
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(jal)
+	{
+		uint32_t target = cur_pc + d->imm;
+		x[d->rd] = cur_pc + d->len;
+		x[0] = 0;
+		cur_pc = target;
+		FAST_NEXT();
+	}
+	FAST_OP(jalr)
+	{
+		uint32_t target = (x[d->rs1] + d->imm) & 0xfffffffe;
+		x[d->rd] = cur_pc + d->len;
+		x[0] = 0;
+		cur_pc = target;
+		FAST_NEXT();
+	}
+	FAST_OP(beq)
+		cur_pc += (x[d->rs1] == x[d->rs2]) ? d->imm : d->len;
+		FAST_NEXT();
+	FAST_OP(bne)
+		cur_pc += (x[d->rs1] != x[d->rs2]) ? d->imm : d->len;
+		FAST_NEXT();
+	FAST_OP(blt)
+		cur_pc += (x[d->rs1] < x[d->rs2]) ? d->imm : d->len;
+		FAST_NEXT();
+	FAST_OP(bge)
+		cur_pc += (x[d->rs1] >= x[d->rs2]) ? d->imm : d->len;
+		FAST_NEXT();
+	FAST_OP(bltu)
+		cur_pc += ((uint32_t)x[d->rs1] < (uint32_t)x[d->rs2]) ? d->imm : d->len;
+		FAST_NEXT();
+	FAST_OP(bgeu)
+		cur_pc += ((uint32_t)x[d->rs1] >= (uint32_t)x[d->rs2]) ? d->imm : d->len;
+		FAST_NEXT();
+	FAST_OP(lb)
+		x[d->rd] = (int8_t)mem->get8(x[d->rs1] + d->imm);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(lh)
+		x[d->rd] = (int16_t)mem->get16(x[d->rs1] + d->imm);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(lw)
+		x[d->rd] = mem->get32(x[d->rs1] + d->imm);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(lbu)
+		x[d->rd] = mem->get8(x[d->rs1] + d->imm);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(lhu)
+		x[d->rd] = mem->get16(x[d->rs1] + d->imm);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	//A store can overwrite cached code, so d is not used after it
+	FAST_OP(sb)
+		mem->set8(x[d->rs1] + d->imm, x[d->rs2]);
+		cur_pc += d->len;
+		FAST_STORE_NEXT();
+	FAST_OP(sh)
+		mem->set16(x[d->rs1] + d->imm, x[d->rs2]);
+		cur_pc += d->len;
+		FAST_STORE_NEXT();
+	FAST_OP(sw)
+		mem->set32(x[d->rs1] + d->imm, x[d->rs2]);
+		cur_pc += d->len;
+		FAST_STORE_NEXT();
+	FAST_OP(addi)
+		x[d->rd] = x[d->rs1] + (uint32_t)d->imm;
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(slti)
+		x[d->rd] = (x[d->rs1] < d->imm) ? 1 : 0;
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(sltiu)
+		x[d->rd] = ((uint32_t)x[d->rs1] < (uint32_t)d->imm) ? 1 : 0;
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(xori)
+		x[d->rd] = x[d->rs1] ^ d->imm;
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(ori)
+		x[d->rd] = x[d->rs1] | d->imm;
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(andi)
+		x[d->rd] = x[d->rs1] & d->imm;
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(slli)
+		x[d->rd] = (uint32_t)x[d->rs1] << (d->imm & 0x1f);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(srli)
+		x[d->rd] = (uint32_t)x[d->rs1] >> (d->imm & 0x1f);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(srai)
+		x[d->rd] = x[d->rs1] >> (d->imm & 0x1f);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(add)
+		x[d->rd] = (uint32_t)x[d->rs1] + (uint32_t)x[d->rs2];
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(sub)
+		x[d->rd] = (uint32_t)x[d->rs1] - (uint32_t)x[d->rs2];
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(sll)
+		x[d->rd] = (uint32_t)x[d->rs1] << (x[d->rs2] & 0x1f);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(slt)
+		x[d->rd] = (x[d->rs1] < x[d->rs2]) ? 1 : 0;
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(sltu)
+		x[d->rd] = ((uint32_t)x[d->rs1] < (uint32_t)x[d->rs2]) ? 1 : 0;
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(xor)
+		x[d->rd] = x[d->rs1] ^ x[d->rs2];
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(srl)
+		x[d->rd] = (uint32_t)x[d->rs1] >> (x[d->rs2] & 0x1f);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(sra)
+		x[d->rd] = x[d->rs1] >> (x[d->rs2] & 0x1f);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(or)
+		x[d->rd] = x[d->rs1] | x[d->rs2];
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(and)
+		x[d->rd] = x[d->rs1] & x[d->rs2];
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(mul)
+		x[d->rd] = (uint32_t)x[d->rs1] * (uint32_t)x[d->rs2];
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(mulh)
+		x[d->rd] = mulh32(x[d->rs1], x[d->rs2]);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(mulhsu)
+		x[d->rd] = mulhsu32(x[d->rs1], x[d->rs2]);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(mulhu)
+		x[d->rd] = mulhu32(x[d->rs1], x[d->rs2]);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(div)
+		x[d->rd] = div32(x[d->rs1], x[d->rs2]);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(divu)
+		x[d->rd] = divu32(x[d->rs1], x[d->rs2]);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(rem)
+		x[d->rd] = rem32(x[d->rs1], x[d->rs2]);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(remu)
+		x[d->rd] = remu32(x[d->rs1], x[d->rs2]);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(sh1add)
+		x[d->rd] = ((uint32_t)x[d->rs1] << 1) + (uint32_t)x[d->rs2];
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(sh2add)
+		x[d->rd] = ((uint32_t)x[d->rs1] << 2) + (uint32_t)x[d->rs2];
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(sh3add)
+		x[d->rd] = ((uint32_t)x[d->rs1] << 3) + (uint32_t)x[d->rs2];
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(andn)
+		x[d->rd] = x[d->rs1] & ~x[d->rs2];
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(orn)
+		x[d->rd] = x[d->rs1] | ~x[d->rs2];
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(xnor)
+		x[d->rd] = ~(x[d->rs1] ^ x[d->rs2]);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(clz)
+		x[d->rd] = clz32(x[d->rs1]);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(ctz)
+		x[d->rd] = ctz32(x[d->rs1]);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(cpop)
+		x[d->rd] = cpop32(x[d->rs1]);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(max)
+		x[d->rd] = x[d->rs1] > x[d->rs2] ? x[d->rs1] : x[d->rs2];
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(maxu)
+		x[d->rd] = (uint32_t)x[d->rs1] > (uint32_t)x[d->rs2] ? x[d->rs1] : x[d->rs2];
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(min)
+		x[d->rd] = x[d->rs1] < x[d->rs2] ? x[d->rs1] : x[d->rs2];
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(minu)
+		x[d->rd] = (uint32_t)x[d->rs1] < (uint32_t)x[d->rs2] ? x[d->rs1] : x[d->rs2];
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(sext_b)
+		x[d->rd] = (int8_t)x[d->rs1];
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(sext_h)
+		x[d->rd] = (int16_t)x[d->rs1];
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(zext_h)
+		x[d->rd] = x[d->rs1] & 0xffff;
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(rol)
+		x[d->rd] = rol32(x[d->rs1], x[d->rs2]);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(ror)
+		x[d->rd] = ror32(x[d->rs1], x[d->rs2]);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(rori)
+		x[d->rd] = ror32(x[d->rs1], d->imm);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(orc_b)
+		x[d->rd] = orc_b32(x[d->rs1]);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(rev8)
+		x[d->rd] = rev8_32(x[d->rs1]);
+		x[0] = 0;
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_OP(fence)
+		atomic_thread_fence(memory_order_seq_cst);
+		cur_pc += d->len;
+		FAST_NEXT();
+	FAST_SLOW
+	{
+		//Runs the normal handler on a copy, with pc and the counter in sync
+		decoded_insn c = *d;
+		pc = cur_pc;
+		insn_counter = count;
+		(this->*c.exec)(c, nullptr);
+		cur_pc = pc;
+
+		if (halt)
+		{
+			goto done;
+		}
+		if (blocks_stale)
+		{
+			goto code_changed;
+		}
+		FAST_NEXT();
+	}
+	code_changed:
+		//Code was written, so uncount the rest of this block and pick again
+		if (b != nullptr)
+		{
+			count -= b->count - (d - &b->ops[0] + 1);
+		}
+	FAST_OP(block_end)
+	{
+	pick_block:
+		if (blocks_stale)
+		{
+			drop_stale_code();
+			b = nullptr;
+		}
+
+		if (count == stop)
+		{
+			goto done;
+		}
+
+		//Follows the chain out of the last block, otherwise searches and chains
+		basic_block* next = nullptr;
+		if (b != nullptr)
+		{
+			if (cur_pc == b->succ_pc[0])
+			{
+				next = b->succ[0];
+			}
+			else if (cur_pc == b->succ_pc[1])
+			{
+				next = b->succ[1];
+			}
+		}
+
+		if (next == nullptr)
+		{
+			next = get_block(cur_pc);
+
+			if (b != nullptr && cur_pc == b->succ_pc[0])
+			{
+				b->succ[0] = next;
+			}
+			else if (b != nullptr && cur_pc == b->succ_pc[1])
+			{
+				b->succ[1] = next;
+			}
+		}
+
+		//Runs the whole block if it fits in the limit, otherwise one instruction
+		if (next != nullptr && stop - count >= next->count)
+		{
+			b = next;
+
+			//Compiles blocks once they are hot and runs them natively
+			if (b->native == nullptr && use_jit && ++b->hits == jit_threshold)
+			{
+				b->native = compiler.compile(b);
+			}
+			if (b->native != nullptr)
+			{
+				cur_pc = b->native(&ctx);
+				count += ctx.retired;
+				goto pick_block;
+			}
+
+			count += b->count;
+			d = &b->ops[0];
+		}
+		else
+		{
+			b = nullptr;
+			count++;
+			step[0] = *lookup(cur_pc, tmp);
+			d = &step[0];
+		}
+		FAST_DISPATCH();
+	}
+#ifndef FAST_THREADED
+		}
+	}
+#endif
+
+done:
+	pc = cur_pc;
+	insn_counter = count;
+}
+
+#undef FAST_OP
+#undef FAST_SLOW
+#undef FAST_DISPATCH
+#undef FAST_NEXT
+#undef FAST_STORE_NEXT
+#undef FAST_THREADED
+
+/**
+ * Runs the rv32i simulation for all instructions in limit
+ * 
+ * @param limit: max instructions to run
+ **/
+void rv32i::run(uint64_t limit)
+{
+	//Everything printed while running is collected and written in big chunks
+	trace_buffer trace(cout.rdbuf());
+	streambuf* console = cout.rdbuf(&trace);
+
+	//Sets register 2 to the top of the stack, unless carrying on from a
+	//checkpoint taken after the program started
+	if (insn_counter == 0)
+	{
+		regs.set(2, stack_top);
+	}
+
+	if (trace_out)
+	{
+		trace_out->start(mem->get_size(), regs.data());
+	}
+
+	//Nothing to show or record while running, so skip all tracing checks
+	if (!show_instructions && !show_registers && trace_out == nullptr)
+	{
+		run_fast(limit);
+	}
+
+	//Instructions are printed by a writer thread replaying them on a copy of
+	//the hart, so the -i lines and the memory warnings between them come
+	//from it alone. Register dumps must be in line, so -r keeps it off.
+	memory* replay_mem = nullptr;
+	rv32i* replay_sim = nullptr;
+	trace_queue* queue = nullptr;
+	thread writer;
+	if (async_trace && show_instructions && !show_registers)
+	{
+		replay_mem = new memory(mem->get_size(), true);
+		replay_sim = new rv32i(replay_mem);
+		replay_sim->replay_start(regs.data());
+
+		queue = new trace_queue();
+		writer = thread([queue, replay_sim]()
+		{
+			trace_record r;
+			while (queue->pop(r))
+			{
+				replay_sim->replay_insn(r);
+			}
+		});
+
+		trace_ring = queue;
+		mem->set_quiet(true);
+	}
+
+	//Goes through simulation 1 instruction at a time until halted or limit reached
+	while (halt != true && (insn_counter != limit || has_insn_limit == false))
+	{
+		tick();
+	}
+
+	//Waits for every line to be printed before the summary
+	if (queue)
+	{
+		queue->close();
+		writer.join();
+
+		mem->set_quiet(false);
+		trace_ring = nullptr;
+		delete queue;
+		delete replay_sim;
+		delete replay_mem;
+	}
+
+	//Prints message if ended with ebreak instruction
+	bool ebreak = at_ebreak();
+	if (ebreak)
+	{
+		cout << "Execution terminated by EBREAK instruction" << endl;
+	}
+
+	//Prints number of instructions executed
+	cout << to_string(insn_counter) << " instructions executed" << endl;
+
+	//Ends the binary trace the same way
+	if (trace_out)
+	{
+		trace_end e;
+		e.pc = pc;
+		e.count = insn_counter;
+		e.ebreak = ebreak;
+		trace_out->finish(e);
+	}
+
+	trace.flush();
+	cout.rdbuf(console);
+}
+
+/**
+ * Runs harts sharing one memory at the same time, each flat out on a host
+ * thread of its own, then prints how each one stopped
+ *
+ * Nothing is shown or recorded while they run. The lines run() ends with are
+ * printed for each hart in turn, after its hart id.
+ *
+ * @param harts: harts to run, all over the same memory
+ * @param limit: instruction limit for each hart that has one
+ **/
+void rv32i::run_harts(const std::vector<rv32i*>& harts, uint64_t limit)
+{
+	vector<thread> threads;
+	for (rv32i* h : harts)
+	{
+		if (h->insn_counter == 0)
+		{
+			h->regs.set(2, h->stack_top);
+		}
+		threads.emplace_back([h, limit]() { h->run_fast(limit); });
+	}
+
+	for (thread& t : threads)
+	{
+		t.join();
+	}
+
+	for (rv32i* h : harts)
+	{
+		string prefix = "hart " + to_string(h->hart_id) + ": ";
+		if (h->at_ebreak())
+		{
+			cout << prefix << "Execution terminated by EBREAK instruction" << endl;
+		}
+		cout << prefix << to_string(h->insn_counter) << " instructions executed" << endl;
+	}
+}
+
+static const char checkpoint_magic[8] = { 'R', 'V', '3', '2', 'C', 'K', 'P', '3' };
+static constexpr uint32_t checkpoint_words = 4 + 32 + 1;     //pc, instruction count (2 words), halt flag, registers, mscratch
+
+/**
+ * Writes the hart and its memory to a checkpoint file that load_checkpoint
+ * can carry on from
+ *
+ * The hart is saved first as little-endian words, then memory::save writes
+ * memory with pages never touched left out.
+ *
+ * @param fname: file to write the checkpoint to
+ *
+ * @return: whether the checkpoint was written
+ **/
+bool rv32i::save_checkpoint(const std::string& fname) const
+{
+	ofstream out(fname, ios::out | ios::binary | ios::trunc);
+	if (!out.is_open())
+	{
+		cerr << "Can't open file \"" << fname << "\" for writing." << endl;
+		return false;
+	}
+
+	uint32_t words[checkpoint_words];
+	words[0] = pc;
+	words[1] = static_cast<uint32_t>(insn_counter);
+	words[2] = static_cast<uint32_t>(insn_counter >> 32);
+	words[3] = halt ? 1 : 0;
+	for (uint32_t i = 0; i < 32; i++)
+	{
+		words[4 + i] = regs.get(i);
+	}
+	words[36] = mscratch;
+
+	uint8_t bytes[checkpoint_words * 4];
+	for (uint32_t i = 0; i < checkpoint_words; i++)
+	{
+		for (uint32_t b = 0; b < 4; b++)
+		{
+			bytes[i * 4 + b] = static_cast<uint8_t>(words[i] >> (8 * b));
+		}
+	}
+
+	out.write(checkpoint_magic, sizeof(checkpoint_magic));
+	out.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+	if (!mem->save(out) || !out.flush())
+	{
+		cerr << "Can't write file \"" << fname << "\"." << endl;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Replaces the hart and its memory with a checkpoint written by
+ * save_checkpoint, so running carries on from where it was saved
+ *
+ * Memory takes the size saved with it. Everything decoded or compiled from
+ * the old contents is thrown away.
+ *
+ * @param fname: checkpoint file to read
+ *
+ * @return false: file could not be opened or is not a checkpoint
+ *		    true: hart and memory restored
+ **/
+bool rv32i::load_checkpoint(const std::string& fname)
+{
+	ifstream in(fname, ios::in | ios::binary);
+	if (!in.is_open())
+	{
+		cerr << "Can't open file \"" << fname << "\" for reading." << endl;
+		return false;
+	}
+
+	char magic[sizeof(checkpoint_magic)];
+	uint8_t bytes[checkpoint_words * 4];
+	if (!in.read(magic, sizeof(magic)) || memcmp(magic, checkpoint_magic, sizeof(magic)) != 0
+		|| !in.read(reinterpret_cast<char*>(bytes), sizeof(bytes)) || !mem->restore(in))
+	{
+		cerr << "\"" << fname << "\" is not a checkpoint file." << endl;
+		return false;
+	}
+
+	uint32_t words[checkpoint_words];
+	for (uint32_t i = 0; i < checkpoint_words; i++)
+	{
+		words[i] = bytes[i * 4] | (bytes[i * 4 + 1] << 8) | (bytes[i * 4 + 2] << 16) | (static_cast<uint32_t>(bytes[i * 4 + 3]) << 24);
+	}
+
+	pc = words[0];
+	insn_counter = words[1] | (static_cast<uint64_t>(words[2]) << 32);
+	halt = words[3] != 0;
+	reserved = false;
+	mem->cancel_reservation(hart_id);
+	for (uint32_t i = 1; i < 32; i++)
+	{
+		regs.set(i, words[4 + i]);
+	}
+	mscratch = words[36];
+
+	//Memory may have changed size, so the caches start again to match it
+	reset_caches();
+	stack_top = mem->get_size();
+
+	return true;
+}
+
+/**
+ * Takes a snapshot of the hart and its memory that rollback can return to,
+ * this hart or another one over a memory made from the snapshot's memory
+ *
+ * @return: the snapshot, sharing memory pages until they are written
+ **/
+rv32i_snapshot rv32i::snapshot()
+{
+	rv32i_snapshot s;
+	s.pc = pc;
+	s.insn_counter = insn_counter;
+	s.halt = halt;
+	for (uint32_t i = 0; i < 32; i++)
+	{
+		s.regs[i] = regs.get(i);
+	}
+	s.mscratch = mscratch;
+	s.mem = mem->snapshot();
+
+	return s;
+}
+
+/**
+ * Puts the hart and its memory back the way they were when a snapshot was
+ * taken
+ *
+ * Forking is a new memory made from s.mem with a new hart over it rolled
+ * back to s, which leaves the memory as it is and only sets the hart.
+ *
+ * @param s: snapshot to return to
+ **/
+void rv32i::rollback(const rv32i_snapshot& s)
+{
+	uint32_t old_size = mem->get_size();
+	mem->rollback(s.mem);
+	if (mem->get_size() != old_size)
+	{
+		reset_caches();
+	}
+
+	pc = s.pc;
+	insn_counter = s.insn_counter;
+	halt = s.halt;
+	reserved = false;
+	mem->cancel_reservation(hart_id);
+	for (uint32_t i = 1; i < 32; i++)
+	{
+		regs.set(i, s.regs[i]);
+	}
+	mscratch = s.mscratch;
+}
+
+/**
+ * Prints a binary trace recorded with set_trace_writer as the text -i would
+ * have printed while it ran
+ *
+ * Memory must be the size the trace was recorded with.
+ *
+ * @param in: trace to print, with its header read
+ **/
+void rv32i::replay(trace_reader& in)
+{
+	trace_buffer trace(cout.rdbuf());
+	streambuf* console = cout.rdbuf(&trace);
+
+	replay_start(in.get_start_regs());
+
+	trace_record r;
+	while (in.next(r))
+	{
+		replay_insn(r);
+	}
+
+	const trace_end& e = in.get_end();
+	if (e.ebreak)
+	{
+		cout << "Execution terminated by EBREAK instruction" << endl;
+	}
+	cout << to_string(e.count) << " instructions executed" << endl;
+
+	trace.flush();
+	cout.rdbuf(console);
+}
+
+/**
+ * Gets ready to replay trace records, from the registers the traced
+ * simulation started with
+ *
+ * @param start: the 32 starting registers
+ **/
+void rv32i::replay_start(const int32_t* start)
+{
+	for (uint32_t i = 1; i < 32; i++)
+	{
+		regs.set(i, start[i]);
+	}
+}
+
+/**
+ * Prints one trace record as its -i line
+ *
+ * The instruction is run again through its exec_* function, from the
+ * recorded pc and with the recorded load value put in memory first, so the
+ * text comes from the same render and formatting code as a live run and
+ * memory warnings come out in the same places. CSR instructions read the
+ * recorded value instead of the CSR.
+ *
+ * @param r: record to print
+ **/
+void rv32i::replay_insn(const trace_record& r)
+{
+	decoded_insn d;
+	decode_insn(r.insn, d);
+
+	//Puts back what the load or atomic read, so it reads the same
+	if (r.has_mem && ((d.op >= op_lb && d.op <= op_lhu) || (d.op >= op_lr_w && d.op <= op_amomaxu_w)))
+	{
+		uint32_t width = (d.op == op_lh || d.op == op_lhu) ? 2 : (d.op == op_lb || d.op == op_lbu) ? 1 : 4;
+		for (uint32_t i = 0; i < width; i++)
+		{
+			uint32_t a = r.mem_addr + i;
+			if (a <= mem->get_size())
+			{
+				mem->set8(a, r.mem_val >> (8 * i));
+			}
+		}
+	}
+
+	pc = r.pc;
+	print_insn_prefix(pc, d);
+	replaying = &r;
+	(this->*d.exec)(d, &std::cout);
+	replaying = nullptr;
+
+	if (r.has_rd)
+	{
+		regs.set(d.rd, r.rd_val);
+	}
+}
+
+/**
+ * Terminates simulation by setting halt flag and renders error message if needed
+ **/
+void rv32i::exec_illegal_insn(const decoded_insn& d, std::ostream* pos)
+{
+	halt = true;
+
+	if (pos)
+	{
+		render_illegal_insn();
+	}
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ * 
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_lui(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t imm = d.imm;
+
+	if (pos)
+	{
+		std::string s = render_lui(d.insn);
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(imm) << endl;
+	}
+
+	regs.set(rd, imm);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_auipc(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t imm = d.imm;
+	
+	int32_t val = pc + imm;
+
+	if (pos)
+	{
+		std::string s = render_auipc(d.insn);
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(pc) << " + " << hex0x32(imm) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_jal(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t imm = d.imm;
+	
+	int32_t pcrel_21 = imm + pc;
+	int32_t val = pc + d.len;
+
+	if (pos)
+	{
+		std::string s = render_jal(d.insn, pc);
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(val) << ",  " << "pc = " << hex0x32(pc) << " + " << hex0x32(imm) << " = " << hex0x32(pcrel_21) << endl;
+	}
+
+	regs.set(rd, val);
+	pc = pcrel_21;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_jalr(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t imm = d.imm;
+	uint32_t rs1 = d.rs1;
+	
+	int32_t rs1val = regs.get(rs1);
+	int32_t val = pc + d.len;
+	int32_t val2 = (imm + rs1val) & 0xfffffffe;
+
+	if (pos)
+	{
+		std::string s = render_jalr(d.insn);
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(val) << ",  " << "pc = (" << hex0x32(imm) << " + " << hex0x32(rs1val) << ") & 0xfffffffe = " << hex0x32(val2) << endl;
+	}
+
+	regs.set(rd, val);
+	pc = val2;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_beq(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+	int32_t imm = d.imm;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t rs2val = regs.get(rs2);
+
+	int32_t val = (rs1val == rs2val) ? imm : d.len;
+	int32_t val2 = pc + val;
+
+	if (pos)
+	{
+		std::string s = render_btype(d.insn, pc, "beq");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "pc += (" << hex0x32(rs1val) << " == " << hex0x32(rs2val) << " ? " << hex0x32(imm) << " : " << to_string(d.len) << ") = " << hex0x32(val2) << endl;
+	}
+
+	pc = val2;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_bne(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+	int32_t imm = d.imm;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t rs2val = regs.get(rs2);
+
+	int32_t val = (rs1val != rs2val) ? imm : d.len;
+	int32_t val2 = pc + val;
+
+	if (pos)
+	{
+		std::string s = render_btype(d.insn, pc, "bne");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "pc += (" << hex0x32(rs1val) << " != " << hex0x32(rs2val) << " ? " << hex0x32(imm) << " : " << to_string(d.len) << ") = " << hex0x32(val2) << endl;
+	}
+
+	pc = val2;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_blt(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+	int32_t imm = d.imm;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t rs2val = regs.get(rs2);
+
+	int32_t val = (rs1val < rs2val) ? imm : d.len;
+	int32_t val2 = pc + val;
+
+	if (pos)
+	{
+		std::string s = render_btype(d.insn, pc, "blt");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "pc += (" << hex0x32(rs1val) << " < " << hex0x32(rs2val) << " ? " << hex0x32(imm) << " : " << to_string(d.len) << ") = " << hex0x32(val2) << endl;
+	}
+
+	pc = val2;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_bge(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+	int32_t imm = d.imm;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t rs2val = regs.get(rs2);
+
+	int32_t val = (rs1val >= rs2val) ? imm : d.len;
+	int32_t val2 = pc + val;
+
+	if (pos)
+	{
+		std::string s = render_btype(d.insn, pc, "bge");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "pc += (" << hex0x32(rs1val) << " >= " << hex0x32(rs2val) << " ? " << hex0x32(imm) << " : " << to_string(d.len) << ") = " << hex0x32(val2) << endl;
+	}
+
+	pc = val2;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_bltu(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+	int32_t imm = d.imm;
+
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t rs2val = regs.get(rs2);
+
+	int32_t val = (rs1val < rs2val) ? imm : d.len;
+	int32_t val2 = pc + val;
+
+	if (pos)
+	{
+		std::string s = render_btype(d.insn, pc, "bltu");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "pc += (" << hex0x32(rs1val) << " <U " << hex0x32(rs2val) << " ? " << hex0x32(imm) << " : " << to_string(d.len) << ") = " << hex0x32(val2) << endl;
+	}
+
+	pc = val2;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_bgeu(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+	int32_t imm = d.imm;
+
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t rs2val = regs.get(rs2);
+
+	int32_t val = (rs1val >= rs2val) ? imm : d.len;
+	int32_t val2 = pc + val;
+
+	if (pos)
+	{
+		std::string s = render_btype(d.insn, pc, "bgeu");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "pc += (" << hex0x32(rs1val) << " >=U " << hex0x32(rs2val) << " ? " << hex0x32(imm) << " : " << to_string(d.len) << ") = " << hex0x32(val2) << endl;
+	}
+
+	pc = val2;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_lb(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t imm = d.imm;
+	uint32_t rs1 = d.rs1;
+
+	int32_t rs1val = regs.get(rs1);
+	uint32_t addr = rs1val + imm;
+	int32_t val = (int8_t)mem->get8(addr);
+
+	if (pos)
+	{
+		std::string s = render_itype_load(d.insn, "lb");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = sx(m8(" << hex0x32(rs1val) << " + " << hex0x32(imm) << ")) = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_lh(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t imm = d.imm;
+	uint32_t rs1 = d.rs1;
+
+	int32_t rs1val = regs.get(rs1);
+	uint32_t addr = rs1val + imm;
+	int32_t val = (int16_t)mem->get16(addr);
+
+	if (pos)
+	{
+		std::string s = render_itype_load(d.insn, "lh");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = sx(m16(" << hex0x32(rs1val) << " + " << hex0x32(imm) << ")) = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_lw(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t imm = d.imm;
+	uint32_t rs1 = d.rs1;
+
+	int32_t rs1val = regs.get(rs1);
+	uint32_t addr = rs1val + imm;
+	int32_t val = mem->get32(addr);
+
+	if (pos)
+	{
+		std::string s = render_itype_load(d.insn, "lw");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = sx(m32(" << hex0x32(rs1val) << " + " << hex0x32(imm) << ")) = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_lbu(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t imm = d.imm;
+	uint32_t rs1 = d.rs1;
+
+	int32_t rs1val = regs.get(rs1);
+	uint32_t addr = rs1val + imm;
+	uint32_t val = mem->get8(addr);
+
+	if (pos)
+	{
+		std::string s = render_itype_load(d.insn, "lbu");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = zx(m8(" << hex0x32(rs1val) << " + " << hex0x32(imm) << ")) = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_lhu(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t imm = d.imm;
+	uint32_t rs1 = d.rs1;
+
+	int32_t rs1val = regs.get(rs1);
+	uint32_t addr = rs1val + imm;
+	uint32_t val = mem->get16(addr);
+
+	if (pos)
+	{
+		std::string s = render_itype_load(d.insn, "lhu");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = zx(m16(" << hex0x32(rs1val) << " + " << hex0x32(imm) << ")) = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_sb(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rs2 = d.rs2;
+	uint32_t imm = d.imm;
+	uint32_t rs1 = d.rs1;
+
+	int32_t rs2val = regs.get(rs2);
+	int32_t rs1val = regs.get(rs1);
+	uint32_t addr = rs1val + imm;
+	uint8_t val = rs2val;
+
+	if (pos)
+	{
+		std::string s = render_stype(d.insn, "sb");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "m8(" << hex0x32(rs1val) << " + " << hex0x32(imm) << ") = " << hex0x32(val) << endl;
+	}
+
+	mem->set8(addr, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_sh(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rs2 = d.rs2;
+	uint32_t imm = d.imm;
+	uint32_t rs1 = d.rs1;
+
+	int32_t rs2val = regs.get(rs2);
+	int32_t rs1val = regs.get(rs1);
+	uint32_t addr = rs1val + imm;
+	uint16_t val = rs2val;
+
+	if (pos)
+	{
+		std::string s = render_stype(d.insn, "sh");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "m16(" << hex0x32(rs1val) << " + " << hex0x32(imm) << ") = " << hex0x32(val) << endl;
+	}
+
+	mem->set16(addr, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_sw(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rs2 = d.rs2;
+	uint32_t imm = d.imm;
+	uint32_t rs1 = d.rs1;
+
+	int32_t rs2val = regs.get(rs2);
+	int32_t rs1val = regs.get(rs1);
+	uint32_t addr = rs1val + imm;
+	uint32_t val = rs2val;
+
+	if (pos)
+	{
+		std::string s = render_stype(d.insn, "sw");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "m32(" << hex0x32(rs1val) << " + " << hex0x32(imm) << ") = " << hex0x32(val) << endl;
+	}
+
+	mem->set32(addr, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_addi(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t imm = d.imm;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t val = rs1val + imm;
+
+	if (pos)
+	{
+		std::string s = render_itype_alu(d.insn, "addi");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " + " << hex0x32(imm) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_slti(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	int32_t imm = d.imm;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t val = (rs1val < imm) ? 1 : 0;
+
+	if (pos)
+	{
+		std::string s = render_itype_alu(d.insn, "slti");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = (" << hex0x32(rs1val) << " < " << imm << ") ? 1 : 0 = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_sltiu(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t imm = d.imm;
+
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t val = (rs1val < imm) ? 1 : 0;
+
+	if (pos)
+	{
+		std::string s = render_itype_alu(d.insn, "sltiu");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = (" << hex0x32(rs1val) << " <U " << imm << ") ? 1 : 0 = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_xori(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t imm = d.imm;
+
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t val = rs1val ^ imm;
+
+	if (pos)
+	{
+		std::string s = render_itype_alu(d.insn, "xori");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " ^ " << hex0x32(imm) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_ori(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t imm = d.imm;
+
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t val = rs1val | imm;
+
+	if (pos)
+	{
+		std::string s = render_itype_alu(d.insn, "ori");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " | " << hex0x32(imm) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_andi(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t imm = d.imm;
+
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t val = rs1val & imm;
+
+	if (pos)
+	{
+		std::string s = render_itype_alu(d.insn, "andi");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " & " << hex0x32(imm) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_slli(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t imm = d.imm;
+
+	uint32_t rs1val = regs.get(rs1);
+	int32_t shamt = imm & 0x0000001F;
+	uint32_t val = rs1val << shamt;
+
+	if (pos)
+	{
+		std::string s = render_itype_alu_shamt(d.insn, "slli");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " << " << shamt << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_srli(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t imm = d.imm;
+
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t shamt = imm & 0x0000001F;
+	uint32_t val = rs1val >> shamt;
+
+	if (pos)
+	{
+		std::string s = render_itype_alu_shamt(d.insn, "srli");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " >> " << shamt << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_srai(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t imm = d.imm;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t shamt = imm & 0x0000001F;
+	int32_t val = rs1val >> shamt;
+
+	if (pos)
+	{
+		std::string s = render_itype_alu_shamt(d.insn, "srai");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " >> " << shamt << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_add(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t rs2val = regs.get(rs2);
+	int32_t val = rs1val + rs2val;
+
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "add");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " + " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_sub(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t rs2val = regs.get(rs2);
+	int32_t val = rs1val - rs2val;
+
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "sub");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " - " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_sll(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t rs2val = regs.get(rs2) & 0x0000001f;
+	int32_t val = rs1val << rs2val;
+
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "sll");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " << " << rs2val << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_slt(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t rs2val = regs.get(rs2);
+	int32_t val = (rs1val < rs2val) ? 1 : 0;
+
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "slt");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = (" << hex0x32(rs1val) << " < " << hex0x32(rs2val) << ") ? 1 : 0 = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_sltu(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t rs2val = regs.get(rs2);
+	uint32_t val = (rs1val < rs2val) ? 1 : 0;
+
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "sltu");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = (" << hex0x32(rs1val) << " <U " << hex0x32(rs2val) << ") ? 1 : 0 = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_xor(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t rs2val = regs.get(rs2);
+	int32_t val = rs1val ^ rs2val;
+
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "xor");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " ^ " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_srl(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t rs2val = regs.get(rs2) & 0x0000001f;
+	uint32_t val = rs1val >> rs2val;
+
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "srl");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " >> " << rs2val << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_sra(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t rs2val = regs.get(rs2) & 0x0000001f;
+	int32_t val = rs1val >> rs2val;
+
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "sra");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " >> " << rs2val << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_or(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t rs2val = regs.get(rs2);
+	int32_t val = rs1val | rs2val;
+
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "or");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " | " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_and(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t rs2val = regs.get(rs2);
+	int32_t val = rs1val & rs2val;
+
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "and");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " & " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_mul(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t rs2val = regs.get(rs2);
+	int32_t val = (uint32_t)rs1val * (uint32_t)rs2val;
+
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "mul");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " * " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_mulh(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t rs2val = regs.get(rs2);
+	int32_t val = mulh32(rs1val, rs2val);
+
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "mulh");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " *H " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_mulhsu(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t rs2val = regs.get(rs2);
+	int32_t val = mulhsu32(rs1val, rs2val);
+
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "mulhsu");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " *HSU " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_mulhu(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t rs2val = regs.get(rs2);
+	uint32_t val = mulhu32(rs1val, rs2val);
+
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "mulhu");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " *HU " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_div(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t rs2val = regs.get(rs2);
+	int32_t val = div32(rs1val, rs2val);
+
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "div");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " / " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_divu(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t rs2val = regs.get(rs2);
+	uint32_t val = divu32(rs1val, rs2val);
+
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "divu");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " /U " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_rem(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	int32_t rs1val = regs.get(rs1);
+	int32_t rs2val = regs.get(rs2);
+	int32_t val = rem32(rs1val, rs2val);
+
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "rem");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "pc += (" << hex0x32(rs1val) << " != " << hex0x32(rs2val) << " ? " << hex0x32(imm) << " : 4) = " << hex0x32(val2) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " % " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
 	}
 
-	pc = val2;
+	regs.set(rd, val);
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_blt(uint32_t insn, std::ostream* pos)
+void rv32i::exec_remu(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-	int32_t imm = get_imm_b(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
 
-	int32_t rs1val = regs.get(rs1);
-	int32_t rs2val = regs.get(rs2);
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t rs2val = regs.get(rs2);
+	uint32_t val = remu32(rs1val, rs2val);
 
-	int32_t val = (rs1val < rs2val) ? imm : 4;
-	int32_t val2 = pc + val;
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "remu");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " %U " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_sh1add(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t rs2val = regs.get(rs2);
+	uint32_t val = (rs1val << 1) + rs2val;
 
 	if (pos)
 	{
-		std::string s = render_btype(insn, "blt");
+		std::string s = render_rtype(d.insn, "sh1add");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "pc += (" << hex0x32(rs1val) << " < " << hex0x32(rs2val) << " ? " << hex0x32(imm) << " : 4) = " << hex0x32(val2) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << "(" << hex0x32(rs1val) << " << 1) + " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
 	}
 
-	pc = val2;
+	regs.set(rd, val);
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_bge(uint32_t insn, std::ostream* pos)
+void rv32i::exec_sh2add(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-	int32_t imm = get_imm_b(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
 
-	int32_t rs1val = regs.get(rs1);
-	int32_t rs2val = regs.get(rs2);
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t rs2val = regs.get(rs2);
+	uint32_t val = (rs1val << 2) + rs2val;
 
-	int32_t val = (rs1val >= rs2val) ? imm : 4;
-	int32_t val2 = pc + val;
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "sh2add");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << "(" << hex0x32(rs1val) << " << 2) + " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_sh3add(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t rs2val = regs.get(rs2);
+	uint32_t val = (rs1val << 3) + rs2val;
 
 	if (pos)
 	{
-		std::string s = render_btype(insn, "bge");
+		std::string s = render_rtype(d.insn, "sh3add");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "pc += (" << hex0x32(rs1val) << " >= " << hex0x32(rs2val) << " ? " << hex0x32(imm) << " : 4) = " << hex0x32(val2) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << "(" << hex0x32(rs1val) << " << 3) + " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
 	}
 
-	pc = val2;
+	regs.set(rd, val);
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_bltu(uint32_t insn, std::ostream* pos)
+void rv32i::exec_andn(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-	int32_t imm = get_imm_b(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
 
 	uint32_t rs1val = regs.get(rs1);
 	uint32_t rs2val = regs.get(rs2);
+	uint32_t val = rs1val & ~rs2val;
 
-	int32_t val = (rs1val < rs2val) ? imm : 4;
-	int32_t val2 = pc + val;
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "andn");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " & ~" << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_orn(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
+
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t rs2val = regs.get(rs2);
+	uint32_t val = rs1val | ~rs2val;
 
 	if (pos)
 	{
-		std::string s = render_btype(insn, "bltu");
+		std::string s = render_rtype(d.insn, "orn");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "pc += (" << hex0x32(rs1val) << " <U " << hex0x32(rs2val) << " ? " << hex0x32(imm) << " : 4) = " << hex0x32(val2) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " | ~" << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
 	}
 
-	pc = val2;
+	regs.set(rd, val);
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_bgeu(uint32_t insn, std::ostream* pos)
+void rv32i::exec_xnor(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-	int32_t imm = get_imm_b(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
 
 	uint32_t rs1val = regs.get(rs1);
 	uint32_t rs2val = regs.get(rs2);
+	uint32_t val = ~(rs1val ^ rs2val);
 
-	int32_t val = (rs1val >= rs2val) ? imm : 4;
-	int32_t val2 = pc + val;
+	if (pos)
+	{
+		std::string s = render_rtype(d.insn, "xnor");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << "~(" << hex0x32(rs1val) << " ^ " << hex0x32(rs2val) << ")" << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_clz(const decoded_insn& d, std::ostream* pos)
+{
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t val = clz32(rs1val);
 
 	if (pos)
 	{
-		std::string s = render_btype(insn, "bgeu");
+		std::string s = render_rtype_unary(d.insn, "clz");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "pc += (" << hex0x32(rs1val) << " >=U " << hex0x32(rs2val) << " ? " << hex0x32(imm) << " : 4) = " << hex0x32(val2) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << "clz(" << hex0x32(rs1val) << ")" << " = " << hex0x32(val) << endl;
 	}
 
-	pc = val2;
+	regs.set(rd, val);
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_lb(uint32_t insn, std::ostream* pos)
+void rv32i::exec_ctz(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t imm = get_imm_i(insn);
-	uint32_t rs1 = get_rs1(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
 
-	int32_t rs1val = regs.get(rs1);
-	uint32_t addr = rs1val + imm;
-	int32_t val = (int8_t)mem->get8(addr);
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t val = ctz32(rs1val);
 
 	if (pos)
 	{
-		std::string s = render_itype_load(insn, "lb");
+		std::string s = render_rtype_unary(d.insn, "ctz");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = sx(m8(" << hex0x32(rs1val) << " + " << hex0x32(imm) << ")) = " << hex0x32(val) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << "ctz(" << hex0x32(rs1val) << ")" << " = " << hex0x32(val) << endl;
 	}
 
 	regs.set(rd, val);
-	pc += 4;
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_lh(uint32_t insn, std::ostream* pos)
+void rv32i::exec_cpop(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t imm = get_imm_i(insn);
-	uint32_t rs1 = get_rs1(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
 
-	int32_t rs1val = regs.get(rs1);
-	uint32_t addr = rs1val + imm;
-	int32_t val = (int16_t)mem->get16(addr);
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t val = cpop32(rs1val);
 
 	if (pos)
 	{
-		std::string s = render_itype_load(insn, "lh");
+		std::string s = render_rtype_unary(d.insn, "cpop");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = sx(m16(" << hex0x32(rs1val) << " + " << hex0x32(imm) << ")) = " << hex0x32(val) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << "cpop(" << hex0x32(rs1val) << ")" << " = " << hex0x32(val) << endl;
 	}
 
 	regs.set(rd, val);
-	pc += 4;
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_lw(uint32_t insn, std::ostream* pos)
+void rv32i::exec_max(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t imm = get_imm_i(insn);
-	uint32_t rs1 = get_rs1(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
 
 	int32_t rs1val = regs.get(rs1);
-	uint32_t addr = rs1val + imm;
-	int32_t val = mem->get32(addr);
+	int32_t rs2val = regs.get(rs2);
+	int32_t val = rs1val > rs2val ? rs1val : rs2val;
 
 	if (pos)
 	{
-		std::string s = render_itype_load(insn, "lw");
+		std::string s = render_rtype(d.insn, "max");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = sx(m32(" << hex0x32(rs1val) << " + " << hex0x32(imm) << ")) = " << hex0x32(val) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << "max(" << hex0x32(rs1val) << ", " << hex0x32(rs2val) << ")" << " = " << hex0x32(val) << endl;
 	}
 
 	regs.set(rd, val);
-	pc += 4;
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_lbu(uint32_t insn, std::ostream* pos)
+void rv32i::exec_maxu(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t imm = get_imm_i(insn);
-	uint32_t rs1 = get_rs1(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
 
-	int32_t rs1val = regs.get(rs1);
-	uint32_t addr = rs1val + imm;
-	uint32_t val = mem->get8(addr);
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t rs2val = regs.get(rs2);
+	uint32_t val = rs1val > rs2val ? rs1val : rs2val;
 
 	if (pos)
 	{
-		std::string s = render_itype_load(insn, "lbu");
+		std::string s = render_rtype(d.insn, "maxu");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = zx(m8(" << hex0x32(rs1val) << " + " << hex0x32(imm) << ")) = " << hex0x32(val) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << "maxu(" << hex0x32(rs1val) << ", " << hex0x32(rs2val) << ")" << " = " << hex0x32(val) << endl;
 	}
 
 	regs.set(rd, val);
-	pc += 4;
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_lhu(uint32_t insn, std::ostream* pos)
+void rv32i::exec_min(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t imm = get_imm_i(insn);
-	uint32_t rs1 = get_rs1(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
 
 	int32_t rs1val = regs.get(rs1);
-	uint32_t addr = rs1val + imm;
-	uint32_t val = mem->get16(addr);
+	int32_t rs2val = regs.get(rs2);
+	int32_t val = rs1val < rs2val ? rs1val : rs2val;
 
 	if (pos)
 	{
-		std::string s = render_itype_load(insn, "lhu");
+		std::string s = render_rtype(d.insn, "min");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = zx(m16(" << hex0x32(rs1val) << " + " << hex0x32(imm) << ")) = " << hex0x32(val) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << "min(" << hex0x32(rs1val) << ", " << hex0x32(rs2val) << ")" << " = " << hex0x32(val) << endl;
 	}
 
 	regs.set(rd, val);
-	pc += 4;
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_sb(uint32_t insn, std::ostream* pos)
+void rv32i::exec_minu(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rs2 = get_rs2(insn);
-	uint32_t imm = get_imm_s(insn);
-	uint32_t rs1 = get_rs1(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
 
-	int32_t rs2val = regs.get(rs2);
-	int32_t rs1val = regs.get(rs1);
-	uint32_t addr = rs1val + imm;
-	uint8_t val = rs2val;
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t rs2val = regs.get(rs2);
+	uint32_t val = rs1val < rs2val ? rs1val : rs2val;
 
 	if (pos)
 	{
-		std::string s = render_stype(insn, "sb");
+		std::string s = render_rtype(d.insn, "minu");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "m8(" << hex0x32(rs1val) << " + " << hex0x32(imm) << ") = " << hex0x32(val) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << "minu(" << hex0x32(rs1val) << ", " << hex0x32(rs2val) << ")" << " = " << hex0x32(val) << endl;
 	}
 
-	mem->set8(addr, val);
-	pc += 4;
+	regs.set(rd, val);
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_sh(uint32_t insn, std::ostream* pos)
+void rv32i::exec_sext_b(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rs2 = get_rs2(insn);
-	uint32_t imm = get_imm_s(insn);
-	uint32_t rs1 = get_rs1(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
 
-	int32_t rs2val = regs.get(rs2);
-	int32_t rs1val = regs.get(rs1);
-	uint32_t addr = rs1val + imm;
-	uint16_t val = rs2val;
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t val = (int8_t)rs1val;
 
 	if (pos)
 	{
-		std::string s = render_stype(insn, "sh");
+		std::string s = render_rtype_unary(d.insn, "sext.b");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "m16(" << hex0x32(rs1val) << " + " << hex0x32(imm) << ") = " << hex0x32(val) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << "sext.b(" << hex0x32(rs1val) << ")" << " = " << hex0x32(val) << endl;
 	}
 
-	mem->set16(addr, val);
-	pc += 4;
+	regs.set(rd, val);
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_sw(uint32_t insn, std::ostream* pos)
+void rv32i::exec_sext_h(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rs2 = get_rs2(insn);
-	uint32_t imm = get_imm_s(insn);
-	uint32_t rs1 = get_rs1(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
 
-	int32_t rs2val = regs.get(rs2);
-	int32_t rs1val = regs.get(rs1);
-	uint32_t addr = rs1val + imm;
-	uint32_t val = rs2val;
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t val = (int16_t)rs1val;
 
 	if (pos)
 	{
-		std::string s = render_stype(insn, "sw");
+		std::string s = render_rtype_unary(d.insn, "sext.h");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "m32(" << hex0x32(rs1val) << " + " << hex0x32(imm) << ") = " << hex0x32(val) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << "sext.h(" << hex0x32(rs1val) << ")" << " = " << hex0x32(val) << endl;
 	}
 
-	mem->set32(addr, val);
-	pc += 4;
+	regs.set(rd, val);
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_addi(uint32_t insn, std::ostream* pos)
+void rv32i::exec_zext_h(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t imm = get_imm_i(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
 
-	int32_t rs1val = regs.get(rs1);
-	int32_t val = rs1val + imm;
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t val = rs1val & 0xffff;
 
 	if (pos)
 	{
-		std::string s = render_itype_alu(insn, "addi");
+		std::string s = render_rtype_unary(d.insn, "zext.h");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " + " << hex0x32(imm) << " = " << hex0x32(val) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << "zext.h(" << hex0x32(rs1val) << ")" << " = " << hex0x32(val) << endl;
 	}
 
 	regs.set(rd, val);
-	pc += 4;
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_slti(uint32_t insn, std::ostream* pos)
+void rv32i::exec_rol(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	int32_t imm = get_imm_i(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
 
-	int32_t rs1val = regs.get(rs1);
-	int32_t val = (rs1val < imm) ? 1 : 0;
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t rs2val = regs.get(rs2);
+	uint32_t val = rol32(rs1val, rs2val);
 
 	if (pos)
 	{
-		std::string s = render_itype_alu(insn, "slti");
+		std::string s = render_rtype(d.insn, "rol");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = (" << hex0x32(rs1val) << " < " << imm << ") ? 1 : 0 = " << hex0x32(val) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " rol " << (rs2val & 0x1f) << " = " << hex0x32(val) << endl;
 	}
 
 	regs.set(rd, val);
-	pc += 4;
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_sltiu(uint32_t insn, std::ostream* pos)
+void rv32i::exec_ror(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t imm = get_imm_i(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t rs2 = d.rs2;
 
 	uint32_t rs1val = regs.get(rs1);
-	uint32_t val = (rs1val < imm) ? 1 : 0;
+	uint32_t rs2val = regs.get(rs2);
+	uint32_t val = ror32(rs1val, rs2val);
 
 	if (pos)
 	{
-		std::string s = render_itype_alu(insn, "sltiu");
+		std::string s = render_rtype(d.insn, "ror");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = (" << hex0x32(rs1val) << " <U " << imm << ") ? 1 : 0 = " << hex0x32(val) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " ror " << (rs2val & 0x1f) << " = " << hex0x32(val) << endl;
 	}
 
 	regs.set(rd, val);
-	pc += 4;
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_xori(uint32_t insn, std::ostream* pos)
+void rv32i::exec_rori(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t imm = get_imm_i(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+	uint32_t imm = d.imm;
 
 	uint32_t rs1val = regs.get(rs1);
-	uint32_t val = rs1val ^ imm;
+	uint32_t shamt = imm & 0x0000001F;
+	uint32_t val = ror32(rs1val, shamt);
 
 	if (pos)
 	{
-		std::string s = render_itype_alu(insn, "xori");
+		std::string s = render_itype_alu_shamt(d.insn, "rori");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " ^ " << hex0x32(imm) << " = " << hex0x32(val) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " ror " << shamt << " = " << hex0x32(val) << endl;
 	}
 
 	regs.set(rd, val);
-	pc += 4;
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_ori(uint32_t insn, std::ostream* pos)
+void rv32i::exec_orc_b(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t imm = get_imm_i(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
 
 	uint32_t rs1val = regs.get(rs1);
-	uint32_t val = rs1val | imm;
+	uint32_t val = orc_b32(rs1val);
 
 	if (pos)
 	{
-		std::string s = render_itype_alu(insn, "ori");
+		std::string s = render_rtype_unary(d.insn, "orc.b");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " | " << hex0x32(imm) << " = " << hex0x32(val) << endl;
+		*pos << s << "// " << "x" << to_string(rd) << " = " << "orc.b(" << hex0x32(rs1val) << ")" << " = " << hex0x32(val) << endl;
 	}
 
 	regs.set(rd, val);
-	pc += 4;
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_andi(uint32_t insn, std::ostream* pos)
+void rv32i::exec_rev8(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t imm = get_imm_i(insn);
+	uint32_t rd = d.rd;
+	uint32_t rs1 = d.rs1;
+
+	uint32_t rs1val = regs.get(rs1);
+	uint32_t val = rev8_32(rs1val);
+
+	if (pos)
+	{
+		std::string s = render_rtype_unary(d.insn, "rev8");
+		s.resize(instruction_width, ' ');
+		*pos << s << "// " << "x" << to_string(rd) << " = " << "rev8(" << hex0x32(rs1val) << ")" << " = " << hex0x32(val) << endl;
+	}
+
+	regs.set(rd, val);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_fence(const decoded_insn& d, std::ostream* pos)
+{
+	if (pos)
+	{
+		std::string s = render_fence(d.insn);
+		s.resize(instruction_width, ' ');
+		*pos << s << "// fence" << endl;
+	}
+
+	//Orders this hart's memory accesses against other harts'
+	atomic_thread_fence(memory_order_seq_cst);
+	pc += d.len;
+}
+
+/**
+ * Simulates instruction execution and renders instuction if render flag set
+ *
+ * With a system call emulator set, the call numbered by a7 is made with
+ * a0 to a5 and a0 gets its result, and exit and exit_group halt. Without
+ * one, ecall just halts. While a trace is replayed the recorded result is
+ * used instead of making the call again.
+ *
+ * @param    d: decoded instruction to execute and render
+ * @param  pos: position of output stream
+ **/
+void rv32i::exec_ecall(const decoded_insn& d, std::ostream* pos)
+{
+	bool emulated = replaying ? replaying->has_rd : sys != nullptr;
+	if (!emulated)
+	{
+		if (pos)
+		{
+			std::string s = render_ecall(d.insn);
+			s.resize(instruction_width, ' ');
+			*pos << s << "// ECALL" << endl;
+		}
+		halt = true;
+		return;
+	}
+
+	uint32_t num = regs.get(17);
+	uint32_t args[6];
+	for (uint32_t i = 0; i < 6; i++)
+	{
+		args[i] = regs.get(10 + i);
+	}
+
+	bool is_exit = false;
+	int32_t val;
+	if (replaying)
+	{
+		is_exit = num == syscall_exit || num == syscall_exit_group;
+		val = replaying->rd_val;
+	}
+	else
+	{
+		val = sys->call(num, args, is_exit);
+	}
+
+	if (pos)
+	{
+		std::string s = render_ecall(d.insn);
+		s.resize(instruction_width, ' ');
+		*pos << s << "// ";
+		if (!is_exit)
+		{
+			*pos << "x10 = ";
+		}
+
+		const char* name = syscalls::name(num);
+		if (name)
+		{
+			*pos << name;
+		}
+		else
+		{
+			*pos << "syscall " << num;
+		}
+
+		*pos << "(";
+		for (uint32_t i = 0; i < syscalls::arg_count(num); i++)
+		{
+			*pos << (i ? ", " : "") << hex0x32(args[i]);
+		}
+		*pos << ")";
 
-	uint32_t rs1val = regs.get(rs1);
-	uint32_t val = rs1val & imm;
+		if (!is_exit)
+		{
+			*pos << " = " << hex0x32(val);
+		}
+		*pos << endl;
+	}
 
-	if (pos)
+	if (is_exit)
 	{
-		std::string s = render_itype_alu(insn, "andi");
-		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " & " << hex0x32(imm) << " = " << hex0x32(val) << endl;
+		exited = true;
+		exit_status = args[0];
+		halt = true;
+		return;
 	}
 
-	regs.set(rd, val);
-	pc += 4;
+	regs.set(10, val);
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_slli(uint32_t insn, std::ostream* pos)
+void rv32i::exec_ebreak(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t imm = get_imm_i(insn);
-
-	uint32_t rs1val = regs.get(rs1);
-	int32_t shamt = imm & 0x0000001F;
-	uint32_t val = rs1val << shamt;
-
 	if (pos)
 	{
-		std::string s = render_itype_alu_shamt(insn, "slli");
+		std::string s = render_ebreak(d.insn); 
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " << " << shamt << " = " << hex0x32(val) << endl;
+		*pos << s << "// HALT" << endl; 
 	}
-
-	regs.set(rd, val);
-	pc += 4;
+	halt = true;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_srli(uint32_t insn, std::ostream* pos)
+void rv32i::exec_csrrw(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t imm = get_imm_i(insn);
-
-	uint32_t rs1val = regs.get(rs1);
-	uint32_t shamt = imm & 0x0000001F;
-	uint32_t val = rs1val >> shamt;
-
-	if (pos)
-	{
-		std::string s = render_itype_alu_shamt(insn, "srli");
-		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " >> " << shamt << " = " << hex0x32(val) << endl;
-	}
-
-	regs.set(rd, val);
-	pc += 4;
+	exec_csr(d, pos, "csrrw", regs.get(d.rs1), true);
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_srai(uint32_t insn, std::ostream* pos)
+void rv32i::exec_csrrs(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t imm = get_imm_i(insn);
-
-	int32_t rs1val = regs.get(rs1);
-	int32_t shamt = imm & 0x0000001F;
-	int32_t val = rs1val >> shamt;
-
-	if (pos)
-	{
-		std::string s = render_itype_alu_shamt(insn, "srai");
-		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " >> " << shamt << " = " << hex0x32(val) << endl;
-	}
-
-	regs.set(rd, val);
-	pc += 4;
+	exec_csr(d, pos, "csrrs", regs.get(d.rs1), d.rs1 != 0);
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_add(uint32_t insn, std::ostream* pos)
+void rv32i::exec_csrrc(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-
-	int32_t rs1val = regs.get(rs1);
-	int32_t rs2val = regs.get(rs2);
-	int32_t val = rs1val + rs2val;
-
-	if (pos)
-	{
-		std::string s = render_rtype(insn, "add");
-		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " + " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
-	}
-
-	regs.set(rd, val);
-	pc += 4;
+	exec_csr(d, pos, "csrrc", regs.get(d.rs1), d.rs1 != 0);
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_sub(uint32_t insn, std::ostream* pos)
+void rv32i::exec_csrrwi(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-
-	int32_t rs1val = regs.get(rs1);
-	int32_t rs2val = regs.get(rs2);
-	int32_t val = rs1val - rs2val;
-
-	if (pos)
-	{
-		std::string s = render_rtype(insn, "sub");
-		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " - " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
-	}
-
-	regs.set(rd, val);
-	pc += 4;
+	exec_csr(d, pos, "csrrwi", d.rs1, true);
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_sll(uint32_t insn, std::ostream* pos)
+void rv32i::exec_csrrsi(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-
-	int32_t rs1val = regs.get(rs1);
-	int32_t rs2val = regs.get(rs2) & 0x0000001f;
-	int32_t val = rs1val << rs2val;
-
-	if (pos)
-	{
-		std::string s = render_rtype(insn, "sll");
-		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " << " << rs2val << " = " << hex0x32(val) << endl;
-	}
-
-	regs.set(rd, val);
-	pc += 4;
+	exec_csr(d, pos, "csrrsi", d.rs1, d.rs1 != 0);
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_slt(uint32_t insn, std::ostream* pos)
+void rv32i::exec_csrrci(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
+	exec_csr(d, pos, "csrrci", d.rs1, d.rs1 != 0);
+}
 
-	int32_t rs1val = regs.get(rs1);
-	int32_t rs2val = regs.get(rs2);
-	int32_t val = (rs1val < rs2val) ? 1 : 0;
+/**
+ * Counts the instructions this hart has retired, which is insn_counter less
+ * the one running now, so a CSR read sees the count from before itself
+ *
+ * @return: instructions retired
+ **/
+uint64_t rv32i::retired() const
+{
+	return insn_counter == 0 ? 0 : insn_counter - 1;
+}
 
-	if (pos)
+/**
+ * Reads a control and status register
+ *
+ * Every instruction takes one cycle, so cycle reads the same as instret.
+ * time counts host microseconds since the simulator started.
+ *
+ * @param csr: number of the register
+ * @param val: where to put its value
+ *
+ * @return: false if this hart has no such register
+ **/
+bool rv32i::read_csr(uint32_t csr, uint32_t& val) const
+{
+	uint64_t us = 0;
+	if (csr == csr_time || csr == csr_timeh)
 	{
-		std::string s = render_rtype(insn, "slt");
-		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = (" << hex0x32(rs1val) << " < " << hex0x32(rs2val) << ") ? 1 : 0 = " << hex0x32(val) << endl;
+		us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - sim_start).count();
 	}
 
-	regs.set(rd, val);
-	pc += 4;
+	switch (csr)
+	{
+	default:
+		return false;
+	case csr_cycle:
+	case csr_instret:
+		val = static_cast<uint32_t>(retired());
+		return true;
+	case csr_cycleh:
+	case csr_instreth:
+		val = static_cast<uint32_t>(retired() >> 32);
+		return true;
+	case csr_time:
+		val = static_cast<uint32_t>(us);
+		return true;
+	case csr_timeh:
+		val = static_cast<uint32_t>(us >> 32);
+		return true;
+	case csr_mscratch:
+		val = mscratch;
+		return true;
+	case csr_mhartid:
+		val = hart_id;
+		return true;
+	}
 }
 
 /**
- * Simulates instruction execution and renders instuction if render flag set
+ * Writes a control and status register
  *
- * @param insn: instruction to execute and render
- * @param  pos: position of output stream
+ * @param csr: number of the register
+ * @param val: value to write
+ *
+ * @return: false if this hart has no such register or it is read-only
  **/
-void rv32i::exec_sltu(uint32_t insn, std::ostream* pos)
+bool rv32i::write_csr(uint32_t csr, uint32_t val)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-
-	uint32_t rs1val = regs.get(rs1);
-	uint32_t rs2val = regs.get(rs2);
-	uint32_t val = (rs1val < rs2val) ? 1 : 0;
-
-	if (pos)
+	switch (csr)
 	{
-		std::string s = render_rtype(insn, "sltu");
-		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = (" << hex0x32(rs1val) << " <U " << hex0x32(rs2val) << ") ? 1 : 0 = " << hex0x32(val) << endl;
+	default:
+		return false;
+	case csr_mscratch:
+		mscratch = val;
+		return true;
 	}
-
-	regs.set(rd, val);
-	pc += 4;
 }
 
 /**
- * Simulates instruction execution and renders instuction if render flag set
+ * Gives the name a CSR is printed with
  *
- * @param insn: instruction to execute and render
- * @param  pos: position of output stream
+ * @param csr: number of the register
+ *
+ * @return: its name, or nullptr if it has none
  **/
-void rv32i::exec_xor(uint32_t insn, std::ostream* pos)
+static const char* csr_name(uint32_t csr)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-
-	int32_t rs1val = regs.get(rs1);
-	int32_t rs2val = regs.get(rs2);
-	int32_t val = rs1val ^ rs2val;
-
-	if (pos)
+	switch (csr)
 	{
-		std::string s = render_rtype(insn, "xor");
-		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " ^ " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
+	default:            return nullptr;
+	case csr_cycle:     return "cycle";
+	case csr_time:      return "time";
+	case csr_instret:   return "instret";
+	case csr_cycleh:    return "cycleh";
+	case csr_timeh:     return "timeh";
+	case csr_instreth:  return "instreth";
+	case csr_mscratch:  return "mscratch";
+	case csr_mhartid:   return "mhartid";
 	}
-
-	regs.set(rd, val);
-	pc += 4;
 }
 
 /**
- * Simulates instruction execution and renders instuction if render flag set
+ * Simulates a CSR instruction and renders it if render flag set. rd gets
+ * the old value, then csrrw writes src, csrrs sets the bits set in src and
+ * csrrc clears them. Writing a read-only or missing CSR is illegal.
  *
- * @param insn: instruction to execute and render
- * @param  pos: position of output stream
+ * While a trace is replayed the value read is the recorded one, so counters
+ * print what they read when the trace was made.
+ *
+ * @param        d: decoded instruction to execute and render
+ * @param      pos: position of output stream
+ * @param mnemonic: mnemonic for specific instruction
+ * @param      src: rs1, or the immediate for the i forms
+ * @param   writes: whether the instruction writes the CSR
  **/
-void rv32i::exec_srl(uint32_t insn, std::ostream* pos)
+void rv32i::exec_csr(const decoded_insn& d, std::ostream* pos, const char* mnemonic, uint32_t src, bool writes)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
+	uint32_t csr = d.insn >> 20;
+	uint32_t val;
+	if (!read_csr(csr, val))
+	{
+		exec_illegal_insn(d, pos);
+		return;
+	}
+	if (replaying && replaying->has_rd)
+	{
+		val = replaying->rd_val;
+	}
+	csr_read = val;
 
-	uint32_t rs1val = regs.get(rs1);
-	uint32_t rs2val = regs.get(rs2) & 0x0000001f;
-	uint32_t val = rs1val >> rs2val;
+	uint32_t new_val = val;
+	switch (d.op)
+	{
+	case op_csrrw:
+	case op_csrrwi:
+		new_val = src;
+		break;
+	case op_csrrs:
+	case op_csrrsi:
+		new_val = val | src;
+		break;
+	default:
+		new_val = val & ~src;
+		break;
+	}
+
+	if (writes && !write_csr(csr, new_val))
+	{
+		exec_illegal_insn(d, pos);
+		return;
+	}
 
 	if (pos)
 	{
-		std::string s = render_rtype(insn, "srl");
+		std::string s = render_itype_spe(mnemonic);
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " >> " << rs2val << " = " << hex0x32(val) << endl;
+		*pos << s << "// " << "x" << to_string(d.rd) << " = " << csr_name(csr) << " = " << hex0x32(val);
+		if (writes)
+		{
+			*pos << ", " << csr_name(csr) << " = " << hex0x32(new_val);
+		}
+		*pos << endl;
 	}
 
-	regs.set(rd, val);
-	pc += 4;
+	regs.set(d.rd, val);
+	pc += d.len;
 }
 
 /**
- * Simulates instruction execution and renders instuction if render flag set
+ * Simulates instruction execution and renders instuction if render flag set.
+ * Loads a word and reserves it for a following sc.w.
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_sra(uint32_t insn, std::ostream* pos)
+void rv32i::exec_lr_w(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
+	uint32_t addr = regs.get(d.rs1);
+	if ((addr & 3) != 0)
+	{
+		exec_illegal_insn(d, pos);
+		return;
+	}
 
-	int32_t rs1val = regs.get(rs1);
-	int32_t rs2val = regs.get(rs2) & 0x0000001f;
-	int32_t val = rs1val >> rs2val;
+	//Reserves the word before reading it, so no write after the read is missed
+	mem->reserve(addr, hart_id);
+	uint32_t val = mem->get32(addr);
+	amo_loaded = val;
 
 	if (pos)
 	{
-		std::string s = render_rtype(insn, "sra");
+		std::string s = render_amo(d.insn, "lr.w");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " >> " << rs2val << " = " << hex0x32(val) << endl;
+		*pos << s << "// " << "x" << to_string(d.rd) << " = m32(" << hex0x32(addr) << ") = " << hex0x32(val) << endl;
 	}
 
-	regs.set(rd, val);
-	pc += 4;
+	//sc.w also checks the word still holds this, for writes begun before
+	//the reservation was
+	reserved = true;
+	reserved_addr = addr;
+	reserved_val = val;
+
+	regs.set(d.rd, val);
+	pc += d.len;
 }
 
 /**
- * Simulates instruction execution and renders instuction if render flag set
+ * Simulates instruction execution and renders instuction if render flag set.
+ * Stores a word if it is still what lr.w reserved, setting rd to 0 if it
+ * did and 1 if not.
  *
- * @param insn: instruction to execute and render
+ * Memory keeps the reservation, and any write to the word by another hart
+ * since lr.w breaks it, even one that put the same value back. The store is
+ * then a host compare and swap against the value lr.w read. A replay takes
+ * the outcome from the record instead, since putting the recorded values
+ * back in memory would break the reservation.
+ *
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_or(uint32_t insn, std::ostream* pos)
+void rv32i::exec_sc_w(const decoded_insn& d, std::ostream* pos)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
+	uint32_t addr = regs.get(d.rs1);
+	uint32_t val = regs.get(d.rs2);
+	if ((addr & 3) != 0)
+	{
+		exec_illegal_insn(d, pos);
+		return;
+	}
 
-	int32_t rs1val = regs.get(rs1);
-	int32_t rs2val = regs.get(rs2);
-	int32_t val = rs1val | rs2val;
+	bool stored = false;
+	if (reserved && reserved_addr == addr && (!mem->check_address(addr) || addr >= mem->get_size()))
+	{
+		exec_illegal_insn(d, pos);
+		return;
+	}
+	if (replaying)
+	{
+		stored = replaying->has_rd && replaying->rd_val == 0;
+		if (stored)
+		{
+			mem->set32(addr, val);
+		}
+		mem->cancel_reservation(hart_id);
+	}
+	else if (reserved && reserved_addr == addr)
+	{
+		stored = mem->store_conditional(addr, hart_id, reserved_val, val, amo_loaded);
+	}
+	else
+	{
+		mem->cancel_reservation(hart_id);
+		amo_loaded = mem->peek32(addr);
+	}
+	reserved = false;
+	sc_stored = stored;
 
 	if (pos)
 	{
-		std::string s = render_rtype(insn, "or");
+		std::string s = render_amo(d.insn, "sc.w");
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " | " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
+		*pos << s << "// ";
+		if (stored)
+		{
+			*pos << "m32(" << hex0x32(addr) << ") = " << hex0x32(val) << ", ";
+		}
+		*pos << "x" << to_string(d.rd) << " = " << (stored ? 0 : 1) << endl;
 	}
 
-	regs.set(rd, val);
-	pc += 4;
+	regs.set(d.rd, stored ? 0 : 1);
+	pc += d.len;
 }
 
 /**
- * Simulates instruction execution and renders instuction if render flag set
+ * Simulates an atomic memory operation and renders it if render flag set:
+ * in one host atomic operation, rd gets the word at rs1 and the word is
+ * replaced by the operation applied to it and rs2
  *
- * @param insn: instruction to execute and render
- * @param  pos: position of output stream
+ * @param        d: decoded instruction to execute and render
+ * @param      pos: position of output stream
+ * @param mnemonic: mnemonic for specific instruction
  **/
-void rv32i::exec_and(uint32_t insn, std::ostream* pos)
+void rv32i::exec_amo(const decoded_insn& d, std::ostream* pos, const char* mnemonic)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
+	uint32_t addr = regs.get(d.rs1);
+	uint32_t src = regs.get(d.rs2);
 
-	int32_t rs1val = regs.get(rs1);
-	int32_t rs2val = regs.get(rs2);
-	int32_t val = rs1val & rs2val;
+	std::atomic<uint32_t>* word = ((addr & 3) == 0) ? mem->atomic_word(addr) : nullptr;
+	if (word == nullptr)
+	{
+		exec_illegal_insn(d, pos);
+		return;
+	}
+
+	//Bitwise and adding operations are single host instructions, the rest
+	//retry a compare and swap until no other hart got in first
+	uint32_t old;
+	uint32_t val;
+	switch (d.op)
+	{
+	default:
+	case op_amoswap_w:
+		old = word->exchange(src);
+		val = src;
+		break;
+	case op_amoadd_w:
+		old = word->fetch_add(src);
+		val = old + src;
+		break;
+	case op_amoxor_w:
+		old = word->fetch_xor(src);
+		val = old ^ src;
+		break;
+	case op_amoand_w:
+		old = word->fetch_and(src);
+		val = old & src;
+		break;
+	case op_amoor_w:
+		old = word->fetch_or(src);
+		val = old | src;
+		break;
+	case op_amomin_w:
+	case op_amomax_w:
+	case op_amominu_w:
+	case op_amomaxu_w:
+		old = word->load();
+		do
+		{
+			switch (d.op)
+			{
+			default:
+			case op_amomin_w:
+				val = (static_cast<int32_t>(src) < static_cast<int32_t>(old)) ? src : old;
+				break;
+			case op_amomax_w:
+				val = (static_cast<int32_t>(src) > static_cast<int32_t>(old)) ? src : old;
+				break;
+			case op_amominu_w:
+				val = (src < old) ? src : old;
+				break;
+			case op_amomaxu_w:
+				val = (src > old) ? src : old;
+				break;
+			}
+		} while (!word->compare_exchange_weak(old, val));
+		break;
+	}
+	amo_loaded = old;
 
 	if (pos)
 	{
-		std::string s = render_rtype(insn, "and");
+		std::string s = render_amo(d.insn, mnemonic);
 		s.resize(instruction_width, ' ');
-		*pos << s << "// " << "x" << to_string(rd) << " = " << hex0x32(rs1val) << " & " << hex0x32(rs2val) << " = " << hex0x32(val) << endl;
+		*pos << s << "// " << "x" << to_string(d.rd) << " = m32(" << hex0x32(addr) << ") = " << hex0x32(old) << ", m32(" << hex0x32(addr) << ") = " << hex0x32(val) << endl;
 	}
 
-	regs.set(rd, val);
-	pc += 4;
+	regs.set(d.rd, old);
+	pc += d.len;
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_fence(uint32_t insn, std::ostream* pos)
+void rv32i::exec_amoswap_w(const decoded_insn& d, std::ostream* pos)
 {
-	if (pos)
-	{
-		std::string s = render_fence(insn);
-		s.resize(instruction_width, ' ');
-		*pos << s << "// fence" << endl;
-	}
-
-	pc += 4;
+	exec_amo(d, pos, "amoswap.w");
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_ecall(uint32_t insn, std::ostream* pos)
+void rv32i::exec_amoadd_w(const decoded_insn& d, std::ostream* pos)
 {
-	if (pos)
-	{
-		std::string s = render_ecall(insn);
-		s.resize(instruction_width, ' ');
-		*pos << s << "// ECALL" << endl;
-	}
-	halt = true;
+	exec_amo(d, pos, "amoadd.w");
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_ebreak(uint32_t insn, std::ostream* pos)
+void rv32i::exec_amoxor_w(const decoded_insn& d, std::ostream* pos)
 {
-	if (pos)
-	{
-		std::string s = render_ebreak(insn); 
-		s.resize(instruction_width, ' ');
-		*pos << s << "// HALT" << endl; 
-	}
-	halt = true;
+	exec_amo(d, pos, "amoxor.w");
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_csrrw(uint32_t insn, std::ostream* pos)
+void rv32i::exec_amoand_w(const decoded_insn& d, std::ostream* pos)
 {
-	exec_illegal_insn(insn, pos);
+	exec_amo(d, pos, "amoand.w");
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_csrrs(uint32_t insn, std::ostream* pos)
+void rv32i::exec_amoor_w(const decoded_insn& d, std::ostream* pos)
 {
-	exec_illegal_insn(insn, pos);
+	exec_amo(d, pos, "amoor.w");
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_csrrc(uint32_t insn, std::ostream* pos)
+void rv32i::exec_amomin_w(const decoded_insn& d, std::ostream* pos)
 {
-	exec_illegal_insn(insn, pos);
+	exec_amo(d, pos, "amomin.w");
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_csrrwi(uint32_t insn, std::ostream* pos)
+void rv32i::exec_amomax_w(const decoded_insn& d, std::ostream* pos)
 {
-	exec_illegal_insn(insn, pos);
+	exec_amo(d, pos, "amomax.w");
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_csrrsi(uint32_t insn, std::ostream* pos)
+void rv32i::exec_amominu_w(const decoded_insn& d, std::ostream* pos)
 {
-	exec_illegal_insn(insn, pos);
+	exec_amo(d, pos, "amominu.w");
 }
 
 /**
  * Simulates instruction execution and renders instuction if render flag set
  *
- * @param insn: instruction to execute and render
+ * @param    d: decoded instruction to execute and render
  * @param  pos: position of output stream
  **/
-void rv32i::exec_csrrci(uint32_t insn, std::ostream* pos)
+void rv32i::exec_amomaxu_w(const decoded_insn& d, std::ostream* pos)
 {
-	exec_illegal_insn(insn, pos);
+	exec_amo(d, pos, "amomaxu.w");
 }
@@ -9,18 +9,192 @@
 #ifndef rv32i_H
 #define rv32i_H
 
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <stdint.h>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 #include "hex.h"
+#include "jit.h"
 #include "memory.h"
 #include "registerfile.h"
+#include "trace.h"
+
+class rv32i;
+class syscalls;
+
+/**
+ * Every operation an instruction can decode to, in the order of the
+ * handlers in exec_table
+ **/
+enum insn_op : uint8_t
+{
+	op_illegal_insn,
+	op_lui,
+	op_auipc,
+	op_jal,
+	op_jalr,
+	op_beq,
+	op_bne,
+	op_blt,
+	op_bge,
+	op_bltu,
+	op_bgeu,
+	op_lb,
+	op_lh,
+	op_lw,
+	op_lbu,
+	op_lhu,
+	op_sb,
+	op_sh,
+	op_sw,
+	op_addi,
+	op_slti,
+	op_sltiu,
+	op_xori,
+	op_ori,
+	op_andi,
+	op_slli,
+	op_srli,
+	op_srai,
+	op_add,
+	op_sub,
+	op_sll,
+	op_slt,
+	op_sltu,
+	op_xor,
+	op_srl,
+	op_sra,
+	op_or,
+	op_and,
+	op_mul,
+	op_mulh,
+	op_mulhsu,
+	op_mulhu,
+	op_div,
+	op_divu,
+	op_rem,
+	op_remu,
+	op_sh1add,
+	op_sh2add,
+	op_sh3add,
+	op_andn,
+	op_orn,
+	op_xnor,
+	op_clz,
+	op_ctz,
+	op_cpop,
+	op_max,
+	op_maxu,
+	op_min,
+	op_minu,
+	op_sext_b,
+	op_sext_h,
+	op_zext_h,
+	op_rol,
+	op_ror,
+	op_rori,
+	op_orc_b,
+	op_rev8,
+	op_fence,
+	op_ecall,
+	op_ebreak,
+	op_csrrw,
+	op_csrrs,
+	op_csrrc,
+	op_csrrwi,
+	op_csrrsi,
+	op_csrrci,
+	op_lr_w,
+	op_sc_w,
+	op_amoswap_w,
+	op_amoadd_w,
+	op_amoxor_w,
+	op_amoand_w,
+	op_amoor_w,
+	op_amomin_w,
+	op_amomax_w,
+	op_amominu_w,
+	op_amomaxu_w,
+	op_count,
+	op_block_end = op_count            //marks the end of a basic block, not an instruction
+};
+
+/**
+ * An instruction decoded once so it can be executed many times: the handler
+ * that runs it plus its register numbers and sign-extended immediate. A
+ * compressed instruction is held as the 32 bit instruction it expands to.
+ **/
+struct decoded_insn
+{
+	void (rv32i::*exec)(const decoded_insn& d, std::ostream* pos);
+	uint32_t insn;
+	int32_t imm;
+	uint8_t op;
+	uint8_t rd;
+	uint8_t rs1;
+	uint8_t rs2;
+	uint8_t len;                       //bytes the instruction takes, 2 if compressed
+	uint16_t cinsn;                    //the compressed encoding, when len is 2
+};
+
+/**
+ * A straight run of decoded instructions ending in a branch, a jump or an
+ * instruction only exec_* can run, linked to the blocks that follow it once
+ * they have been looked up
+ **/
+struct basic_block
+{
+	uint32_t start;                    //address of the first instruction
+	uint32_t end;                      //address just past the last instruction
+	uint32_t count;                    //instructions in the block
+	std::vector<decoded_insn> ops;     //the instructions, then an op_block_end marker
+	uint32_t succ_pc[2];               //addresses execution can continue at
+	basic_block* succ[2];              //chained blocks for those addresses
+	uint32_t hits;                     //times the block has been entered
+	jit_fn native;                     //compiled block, once it is hot
+};
 
-class rv32i
+/**
+ * A hart and its memory at one moment, for rv32i::rollback to return to
+ **/
+struct rv32i_snapshot
+{
+	uint32_t pc;
+	uint64_t insn_counter;
+	bool halt;
+	int32_t regs[32];
+	uint32_t mscratch;
+	memory_snapshot mem;
+};
+
+class rv32i : public code_observer
 {
 private:
 	memory* mem;
 	uint32_t pc;
+	uint32_t hart_id;                       //what mhartid reads as
+	uint32_t stack_top;                     //x2 when the simulation starts
+
+	static constexpr uint32_t disasm_chunk_size = 64 * 1024;     //bytes of memory disassembled by one worker at a time
+	static constexpr uint32_t dcache_page_entries = memory::page_size / 2;     //one per halfword, where compressed code can start
+	std::vector<decoded_insn*> dcache;      //decoded instructions, one array per page allocated on first use
+
+	static constexpr uint32_t block_max_insns = 64;
+	static constexpr uint32_t no_successor = 1;
+	std::vector<basic_block**> bcache;      //basic blocks by start address, one array per page
+	std::atomic<bool> blocks_stale;         //code was written, decodes and blocks must be dropped
+	std::mutex stale_lock;                  //guards stale_pages, which any hart may add to
+	std::vector<uint32_t> stale_pages;      //pages written since their decodes were last dropped
+
+	static constexpr uint32_t jit_threshold = 16;
+	jit compiler;                           //compiles blocks entered jit_threshold times
+	bool use_jit;
 
 	registerfile regs;
 	bool halt;
@@ -28,83 +202,179 @@ private:
 	bool show_registers;
 	bool has_insn_limit;
 	uint64_t insn_counter;
+	trace_writer* trace_out;                //binary trace being recorded, if any
+	trace_queue* trace_ring;                //records for the -i writer thread, if it is running
+	bool async_trace;
+	bool reserved;                          //lr.w reserved reserved_addr, holding reserved_val
+	uint32_t reserved_addr;
+	uint32_t reserved_val;
+	bool sc_stored;                         //whether the last sc.w stored, for record_insn
+	uint32_t amo_loaded;                    //word the last lr.w, sc.w or AMO read, for record_insn
+	uint32_t csr_read;                      //value the last CSR instruction read, for record_insn
+	uint32_t mscratch;
+	const trace_record* replaying;          //record replay_insn is printing, whose CSR reads are used again
+	syscalls* sys;                          //makes ecall's system calls, or nullptr if ecall just halts
+	bool exited;                            //the program called exit or exit_group
+	int32_t exit_status;
+
+	static void (rv32i::* const exec_table[op_count])(const decoded_insn& d, std::ostream* pos);
+
+	void decode_insn(uint32_t insn, decoded_insn& d) const;
+	void fetch(uint32_t addr, decoded_insn& d);
+	const decoded_insn* lookup(uint32_t addr, decoded_insn& tmp);
+	basic_block* translate_block(uint32_t addr);
+	basic_block* get_block(uint32_t addr);
+	void flush_blocks();
+	void drop_stale_code();
+	void reset_caches();
+	void run_fast(uint64_t limit);
+	uint32_t read_insn(uint32_t addr) const;
+	bool at_ebreak() const;
+	void print_insn_prefix(uint32_t addr, const decoded_insn& d) const;
+	void record_insn(trace_record& r, const decoded_insn& d, uint32_t addr, int32_t rs1val, int32_t rs2val) const;
+	uint64_t retired() const;
+	bool read_csr(uint32_t csr, uint32_t& val) const;
+	bool write_csr(uint32_t csr, uint32_t val);
+	void exec_csr(const decoded_insn& d, std::ostream* pos, const char* mnemonic, uint32_t src, bool writes);
+	void exec_amo(const decoded_insn& d, std::ostream* pos, const char* mnemonic);
 
 public:
 	rv32i(memory*);
-	void disasm(void);
-	std::string decode(uint32_t) const;
+	~rv32i();
+	void disasm(bool touched_only = false);
+	uint32_t disasm_range(uint32_t begin, uint32_t end, std::string& out) const;
+	std::string decode(uint32_t insn, uint32_t addr) const;
 	std::string render_illegal_insn() const;
 	std::string render_lui(uint32_t insn) const;
 	std::string render_auipc(uint32_t insn) const;
-	std::string render_jal(uint32_t insn) const;
+	std::string render_jal(uint32_t insn, uint32_t addr) const;
 	std::string render_jalr(uint32_t insn) const;
-	std::string render_btype(uint32_t insn, const char* mnemonic) const;
+	std::string render_btype(uint32_t insn, uint32_t addr, const char* mnemonic) const;
 	std::string render_itype_load(uint32_t insn, const char* mnemonic) const;
 	std::string render_stype(uint32_t insn, const char* mnemonic) const;
 	std::string render_itype_alu(uint32_t insn, const char* mnemonic) const;
 	std::string render_itype_alu_shamt(uint32_t insn, const char* mnemonic) const;
 	std::string render_rtype(uint32_t insn, const char* mnemonic) const;
+	std::string render_rtype_unary(uint32_t insn, const char* mnemonic) const;
 	std::string render_fence(uint32_t insn) const;
 	std::string render_ecall(uint32_t insn) const;
 	std::string render_ebreak(uint32_t insn) const;
 	std::string render_itype_spe(const char* mnemonic) const;
+	std::string render_amo(uint32_t insn, const char* mnemonic) const;
 
 	void set_show_instructions(bool b);
 	void set_show_registers(bool b);
 	void set_has_insn_limit(bool b);
+	void set_stack_top(uint32_t addr);
+	void set_use_jit(bool b);
+	void set_trace_writer(trace_writer* t);
+	void set_async_trace(bool b);
+	void set_hart_id(uint32_t id);
+	void set_syscalls(syscalls* s);
 	bool is_halted() const;
+	bool has_exited() const;
+	int32_t get_exit_status() const;
 	void reset();
+	bool save_checkpoint(const std::string& fname) const;
+	bool load_checkpoint(const std::string& fname);
+	rv32i_snapshot snapshot();
+	void rollback(const rv32i_snapshot& s);
 	void dump() const;
 	void dcex(uint32_t insn, std::ostream* pos);
-	void exec_illegal_insn(uint32_t insn, std::ostream* pos);
-	void exec_lui(uint32_t insn, std::ostream* pos);
-	void exec_auipc(uint32_t insn, std::ostream* pos);
-	void exec_jal(uint32_t insn, std::ostream* pos);
-	void exec_jalr(uint32_t insn, std::ostream* pos);
-	void exec_beq(uint32_t insn, std::ostream* pos);
-	void exec_bne(uint32_t insn, std::ostream* pos);
-	void exec_blt(uint32_t insn, std::ostream* pos);
-	void exec_bge(uint32_t insn, std::ostream* pos);
-	void exec_bltu(uint32_t insn, std::ostream* pos);
-	void exec_bgeu(uint32_t insn, std::ostream* pos);
-	void exec_lb(uint32_t insn, std::ostream* pos);
-	void exec_lh(uint32_t insn, std::ostream* pos);
-	void exec_lw(uint32_t insn, std::ostream* pos);
-	void exec_lbu(uint32_t insn, std::ostream* pos);
-	void exec_lhu(uint32_t insn, std::ostream* pos);
-	void exec_sb(uint32_t insn, std::ostream* pos);
-	void exec_sh(uint32_t insn, std::ostream* pos);
-	void exec_sw(uint32_t insn, std::ostream* pos);
-	void exec_addi(uint32_t insn, std::ostream* pos);
-	void exec_slti(uint32_t insn, std::ostream* pos);
-	void exec_sltiu(uint32_t insn, std::ostream* pos);
-	void exec_xori(uint32_t insn, std::ostream* pos);
-	void exec_ori(uint32_t insn, std::ostream* pos);
-	void exec_andi(uint32_t insn, std::ostream* pos);
-	void exec_slli(uint32_t insn, std::ostream* pos);
-	void exec_srli(uint32_t insn, std::ostream* pos);
-	void exec_srai(uint32_t insn, std::ostream* pos);
-	void exec_add(uint32_t insn, std::ostream* pos);
-	void exec_sub(uint32_t insn, std::ostream* pos);
-	void exec_sll(uint32_t insn, std::ostream* pos);
-	void exec_slt(uint32_t insn, std::ostream* pos);
-	void exec_sltu(uint32_t insn, std::ostream* pos);
-	void exec_xor(uint32_t insn, std::ostream* pos);
-	void exec_srl(uint32_t insn, std::ostream* pos);
-	void exec_sra(uint32_t insn, std::ostream* pos);
-	void exec_or(uint32_t insn, std::ostream* pos);
-	void exec_and(uint32_t insn, std::ostream* pos);
-	void exec_fence(uint32_t insn, std::ostream* pos);
-	void exec_ecall(uint32_t insn, std::ostream* pos);
-	void exec_ebreak(uint32_t insn, std::ostream* pos);
-	void exec_csrrw(uint32_t insn, std::ostream* pos);
-	void exec_csrrs(uint32_t insn, std::ostream* pos);
-	void exec_csrrc(uint32_t insn, std::ostream* pos);
-	void exec_csrrwi(uint32_t insn, std::ostream* pos);
-	void exec_csrrsi(uint32_t insn, std::ostream* pos);
-	void exec_csrrci(uint32_t insn, std::ostream* pos);
+	void code_modified(uint32_t page) override;
+	void exec_illegal_insn(const decoded_insn& d, std::ostream* pos);
+	void exec_lui(const decoded_insn& d, std::ostream* pos);
+	void exec_auipc(const decoded_insn& d, std::ostream* pos);
+	void exec_jal(const decoded_insn& d, std::ostream* pos);
+	void exec_jalr(const decoded_insn& d, std::ostream* pos);
+	void exec_beq(const decoded_insn& d, std::ostream* pos);
+	void exec_bne(const decoded_insn& d, std::ostream* pos);
+	void exec_blt(const decoded_insn& d, std::ostream* pos);
+	void exec_bge(const decoded_insn& d, std::ostream* pos);
+	void exec_bltu(const decoded_insn& d, std::ostream* pos);
+	void exec_bgeu(const decoded_insn& d, std::ostream* pos);
+	void exec_lb(const decoded_insn& d, std::ostream* pos);
+	void exec_lh(const decoded_insn& d, std::ostream* pos);
+	void exec_lw(const decoded_insn& d, std::ostream* pos);
+	void exec_lbu(const decoded_insn& d, std::ostream* pos);
+	void exec_lhu(const decoded_insn& d, std::ostream* pos);
+	void exec_sb(const decoded_insn& d, std::ostream* pos);
+	void exec_sh(const decoded_insn& d, std::ostream* pos);
+	void exec_sw(const decoded_insn& d, std::ostream* pos);
+	void exec_addi(const decoded_insn& d, std::ostream* pos);
+	void exec_slti(const decoded_insn& d, std::ostream* pos);
+	void exec_sltiu(const decoded_insn& d, std::ostream* pos);
+	void exec_xori(const decoded_insn& d, std::ostream* pos);
+	void exec_ori(const decoded_insn& d, std::ostream* pos);
+	void exec_andi(const decoded_insn& d, std::ostream* pos);
+	void exec_slli(const decoded_insn& d, std::ostream* pos);
+	void exec_srli(const decoded_insn& d, std::ostream* pos);
+	void exec_srai(const decoded_insn& d, std::ostream* pos);
+	void exec_add(const decoded_insn& d, std::ostream* pos);
+	void exec_sub(const decoded_insn& d, std::ostream* pos);
+	void exec_sll(const decoded_insn& d, std::ostream* pos);
+	void exec_slt(const decoded_insn& d, std::ostream* pos);
+	void exec_sltu(const decoded_insn& d, std::ostream* pos);
+	void exec_xor(const decoded_insn& d, std::ostream* pos);
+	void exec_srl(const decoded_insn& d, std::ostream* pos);
+	void exec_sra(const decoded_insn& d, std::ostream* pos);
+	void exec_or(const decoded_insn& d, std::ostream* pos);
+	void exec_and(const decoded_insn& d, std::ostream* pos);
+	void exec_mul(const decoded_insn& d, std::ostream* pos);
+	void exec_mulh(const decoded_insn& d, std::ostream* pos);
+	void exec_mulhsu(const decoded_insn& d, std::ostream* pos);
+	void exec_mulhu(const decoded_insn& d, std::ostream* pos);
+	void exec_div(const decoded_insn& d, std::ostream* pos);
+	void exec_divu(const decoded_insn& d, std::ostream* pos);
+	void exec_rem(const decoded_insn& d, std::ostream* pos);
+	void exec_remu(const decoded_insn& d, std::ostream* pos);
+	void exec_sh1add(const decoded_insn& d, std::ostream* pos);
+	void exec_sh2add(const decoded_insn& d, std::ostream* pos);
+	void exec_sh3add(const decoded_insn& d, std::ostream* pos);
+	void exec_andn(const decoded_insn& d, std::ostream* pos);
+	void exec_orn(const decoded_insn& d, std::ostream* pos);
+	void exec_xnor(const decoded_insn& d, std::ostream* pos);
+	void exec_clz(const decoded_insn& d, std::ostream* pos);
+	void exec_ctz(const decoded_insn& d, std::ostream* pos);
+	void exec_cpop(const decoded_insn& d, std::ostream* pos);
+	void exec_max(const decoded_insn& d, std::ostream* pos);
+	void exec_maxu(const decoded_insn& d, std::ostream* pos);
+	void exec_min(const decoded_insn& d, std::ostream* pos);
+	void exec_minu(const decoded_insn& d, std::ostream* pos);
+	void exec_sext_b(const decoded_insn& d, std::ostream* pos);
+	void exec_sext_h(const decoded_insn& d, std::ostream* pos);
+	void exec_zext_h(const decoded_insn& d, std::ostream* pos);
+	void exec_rol(const decoded_insn& d, std::ostream* pos);
+	void exec_ror(const decoded_insn& d, std::ostream* pos);
+	void exec_rori(const decoded_insn& d, std::ostream* pos);
+	void exec_orc_b(const decoded_insn& d, std::ostream* pos);
+	void exec_rev8(const decoded_insn& d, std::ostream* pos);
+	void exec_fence(const decoded_insn& d, std::ostream* pos);
+	void exec_ecall(const decoded_insn& d, std::ostream* pos);
+	void exec_ebreak(const decoded_insn& d, std::ostream* pos);
+	void exec_csrrw(const decoded_insn& d, std::ostream* pos);
+	void exec_csrrs(const decoded_insn& d, std::ostream* pos);
+	void exec_csrrc(const decoded_insn& d, std::ostream* pos);
+	void exec_csrrwi(const decoded_insn& d, std::ostream* pos);
+	void exec_csrrsi(const decoded_insn& d, std::ostream* pos);
+	void exec_csrrci(const decoded_insn& d, std::ostream* pos);
+	void exec_lr_w(const decoded_insn& d, std::ostream* pos);
+	void exec_sc_w(const decoded_insn& d, std::ostream* pos);
+	void exec_amoswap_w(const decoded_insn& d, std::ostream* pos);
+	void exec_amoadd_w(const decoded_insn& d, std::ostream* pos);
+	void exec_amoxor_w(const decoded_insn& d, std::ostream* pos);
+	void exec_amoand_w(const decoded_insn& d, std::ostream* pos);
+	void exec_amoor_w(const decoded_insn& d, std::ostream* pos);
+	void exec_amomin_w(const decoded_insn& d, std::ostream* pos);
+	void exec_amomax_w(const decoded_insn& d, std::ostream* pos);
+	void exec_amominu_w(const decoded_insn& d, std::ostream* pos);
+	void exec_amomaxu_w(const decoded_insn& d, std::ostream* pos);
 	void tick();
 	void run(uint64_t limit);
+	static void run_harts(const std::vector<rv32i*>& harts, uint64_t limit);
+	void replay(trace_reader& in);
+	void replay_start(const int32_t* start);
+	void replay_insn(const trace_record& r);
 };
 	
 static constexpr uint32_t XLEN = 32;
@@ -120,6 +390,7 @@ static constexpr uint32_t opcode_stype      = 0b0100011;
 static constexpr uint32_t opcode_itype_alu  = 0b0010011;
 static constexpr uint32_t opcode_rtype      = 0b0110011;
 static constexpr uint32_t opcode_fence      = 0b0001111;
+static constexpr uint32_t opcode_amo        = 0b0101111;
 static constexpr uint32_t opcode_itype_spe  = 0b1110011;
 
 static constexpr uint32_t funct3_beq  = 0b000;
@@ -163,6 +434,37 @@ static constexpr uint32_t funct7_sra    = 0b0100000;
 static constexpr uint32_t funct3_or     = 0b110;
 static constexpr uint32_t funct3_and    = 0b111;
 
+static constexpr uint32_t funct7_muldiv = 0b0000001;
+static constexpr uint32_t funct3_mul    = 0b000;
+static constexpr uint32_t funct3_mulh   = 0b001;
+static constexpr uint32_t funct3_mulhsu = 0b010;
+static constexpr uint32_t funct3_mulhu  = 0b011;
+static constexpr uint32_t funct3_div    = 0b100;
+static constexpr uint32_t funct3_divu   = 0b101;
+static constexpr uint32_t funct3_rem    = 0b110;
+static constexpr uint32_t funct3_remu   = 0b111;
+
+static constexpr uint32_t funct7_shadd   = 0b0010000;
+static constexpr uint32_t funct3_sh1add  = 0b010;
+static constexpr uint32_t funct3_sh2add  = 0b100;
+static constexpr uint32_t funct3_sh3add  = 0b110;
+static constexpr uint32_t funct7_negated = 0b0100000;     //andn, orn and xnor, with the funct3 of and, or and xor
+static constexpr uint32_t funct7_minmax  = 0b0000101;
+static constexpr uint32_t funct3_min     = 0b100;
+static constexpr uint32_t funct3_minu    = 0b101;
+static constexpr uint32_t funct3_max     = 0b110;
+static constexpr uint32_t funct3_maxu    = 0b111;
+static constexpr uint32_t funct7_zext_h  = 0b0000100;     //with the funct3 of xor and rs2 0
+static constexpr uint32_t funct7_rotate  = 0b0110000;     //rol, ror and rori, with the funct3 of sll and srl
+static constexpr uint32_t funct7_unary   = 0b0110000;     //clz and the rest, with the funct3 of slli and rs2 picking one
+static constexpr uint32_t unary_clz      = 0b00000;
+static constexpr uint32_t unary_ctz      = 0b00001;
+static constexpr uint32_t unary_cpop     = 0b00010;
+static constexpr uint32_t unary_sext_b   = 0b00100;
+static constexpr uint32_t unary_sext_h   = 0b00101;
+static constexpr uint32_t imm_orc_b      = 0x287;         //immediates of orc.b and rev8, with the funct3 of srli
+static constexpr uint32_t imm_rev8       = 0x698;
+
 static constexpr uint32_t funct3_ecallbreak = 0b000;
 static constexpr uint32_t insn_ecall        = 0x00000073;
 static constexpr uint32_t insn_ebreak       = 0x00100073;
@@ -173,4 +475,162 @@ static constexpr uint32_t funct3_csrrwi     = 0b101;
 static constexpr uint32_t funct3_csrrsi     = 0b110;
 static constexpr uint32_t funct3_csrrci     = 0b111;
 
+static constexpr uint32_t csr_cycle    = 0xc00;
+static constexpr uint32_t csr_time     = 0xc01;
+static constexpr uint32_t csr_instret  = 0xc02;
+static constexpr uint32_t csr_cycleh   = 0xc80;
+static constexpr uint32_t csr_timeh    = 0xc81;
+static constexpr uint32_t csr_instreth = 0xc82;
+static constexpr uint32_t csr_mscratch = 0x340;
+static constexpr uint32_t csr_mhartid  = 0xf14;
+
+static constexpr uint32_t funct3_amo_w    = 0b010;
+static constexpr uint32_t funct5_lr       = 0b00010;
+static constexpr uint32_t funct5_sc       = 0b00011;
+static constexpr uint32_t funct5_amoswap  = 0b00001;
+static constexpr uint32_t funct5_amoadd   = 0b00000;
+static constexpr uint32_t funct5_amoxor   = 0b00100;
+static constexpr uint32_t funct5_amoand   = 0b01100;
+static constexpr uint32_t funct5_amoor    = 0b01000;
+static constexpr uint32_t funct5_amomin   = 0b10000;
+static constexpr uint32_t funct5_amomax   = 0b10100;
+static constexpr uint32_t funct5_amominu  = 0b11000;
+static constexpr uint32_t funct5_amomaxu  = 0b11100;
+static constexpr uint32_t amo_aq          = 1u << 26;
+static constexpr uint32_t amo_rl          = 1u << 25;
+
+/**
+ * The M extension's arithmetic, shared by the interpreters and compiled
+ * code. Dividing by zero gives all ones for a quotient and the dividend
+ * for a remainder, and the one signed overflow (-2^31 / -1) gives the
+ * dividend and 0, as the spec requires rather than trapping.
+ **/
+inline uint32_t mulh32(int32_t a, int32_t b)
+{
+	return static_cast<uint64_t>(static_cast<int64_t>(a) * b) >> 32;
+}
+
+inline uint32_t mulhsu32(int32_t a, uint32_t b)
+{
+	return static_cast<uint64_t>(static_cast<int64_t>(a) * static_cast<int64_t>(b)) >> 32;
+}
+
+inline uint32_t mulhu32(uint32_t a, uint32_t b)
+{
+	return (static_cast<uint64_t>(a) * b) >> 32;
+}
+
+inline uint32_t div32(int32_t a, int32_t b)
+{
+	if (b == 0)
+	{
+		return 0xffffffff;
+	}
+	if (a == INT32_MIN && b == -1)
+	{
+		return a;
+	}
+	return a / b;
+}
+
+inline uint32_t divu32(uint32_t a, uint32_t b)
+{
+	return b == 0 ? 0xffffffff : a / b;
+}
+
+inline uint32_t rem32(int32_t a, int32_t b)
+{
+	if (b == 0)
+	{
+		return a;
+	}
+	if (a == INT32_MIN && b == -1)
+	{
+		return 0;
+	}
+	return a % b;
+}
+
+inline uint32_t remu32(uint32_t a, uint32_t b)
+{
+	return b == 0 ? a : a % b;
+}
+
+/**
+ * The Zbb extension's bit counts, byte swap and rotates, shared by the
+ * interpreters and compiled code, each done with the host's own intrinsic
+ **/
+inline uint32_t clz32(uint32_t a)
+{
+	if (a == 0)
+	{
+		return 32;
+	}
+#if defined(_MSC_VER)
+	unsigned long i;
+	_BitScanReverse(&i, a);
+	return 31 - i;
+#else
+	return __builtin_clz(a);
+#endif
+}
+
+inline uint32_t ctz32(uint32_t a)
+{
+	if (a == 0)
+	{
+		return 32;
+	}
+#if defined(_MSC_VER)
+	unsigned long i;
+	_BitScanForward(&i, a);
+	return i;
+#else
+	return __builtin_ctz(a);
+#endif
+}
+
+inline uint32_t cpop32(uint32_t a)
+{
+#if defined(_MSC_VER)
+	return __popcnt(a);
+#else
+	return __builtin_popcount(a);
+#endif
+}
+
+inline uint32_t rev8_32(uint32_t a)
+{
+#if defined(_MSC_VER)
+	return _byteswap_ulong(a);
+#else
+	return __builtin_bswap32(a);
+#endif
+}
+
+inline uint32_t rol32(uint32_t a, uint32_t n)
+{
+#if defined(_MSC_VER)
+	return _rotl(a, n & 0x1f);
+#else
+	return (a << (n & 0x1f)) | (a >> (-n & 0x1f));
+#endif
+}
+
+inline uint32_t ror32(uint32_t a, uint32_t n)
+{
+#if defined(_MSC_VER)
+	return _rotr(a, n & 0x1f);
+#else
+	return (a >> (n & 0x1f)) | (a << (-n & 0x1f));
+#endif
+}
+
+//Every byte that is not zero becomes 0xff
+inline uint32_t orc_b32(uint32_t a)
+{
+	uint32_t high = (((a & 0x7f7f7f7f) + 0x7f7f7f7f) | a) & 0x80808080;
+	return (high >> 7) * 0xff;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,817 @@
+//*****************************************************************************
+//
+//  syscalls.cpp
+//  CSCI 463 Assignment 5
+//
+//  Created by Daniel Widing (z1838064)
+//
+//*****************************************************************************
+#include <iostream>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "syscalls.h"
+
+using namespace std;
+
+//Linux errno values, which guests see whatever the host's are
+static constexpr int32_t guest_enoent       = 2;
+static constexpr int32_t guest_eio          = 5;
+static constexpr int32_t guest_ebadf        = 9;
+static constexpr int32_t guest_enomem       = 12;
+static constexpr int32_t guest_eacces       = 13;
+static constexpr int32_t guest_efault       = 14;
+static constexpr int32_t guest_eexist       = 17;
+static constexpr int32_t guest_enodev       = 19;
+static constexpr int32_t guest_enotdir      = 20;
+static constexpr int32_t guest_eisdir       = 21;
+static constexpr int32_t guest_einval       = 22;
+static constexpr int32_t guest_emfile       = 24;
+static constexpr int32_t guest_enospc       = 28;
+static constexpr int32_t guest_espipe       = 29;
+static constexpr int32_t guest_enametoolong = 36;
+static constexpr int32_t guest_enosys       = 38;
+static constexpr int32_t guest_eoverflow    = 75;
+
+//Linux open flags and openat's directory for the working directory
+static constexpr uint32_t guest_o_accmode = 0x003;
+static constexpr uint32_t guest_o_wronly  = 0x001;
+static constexpr uint32_t guest_o_rdwr    = 0x002;
+static constexpr uint32_t guest_o_creat   = 0x040;
+static constexpr uint32_t guest_o_excl    = 0x080;
+static constexpr uint32_t guest_o_trunc   = 0x200;
+static constexpr uint32_t guest_o_append  = 0x400;
+static constexpr int32_t guest_at_fdcwd   = -100;
+
+//Linux mmap protections and flags
+static constexpr uint32_t guest_prot_write     = 0x02;
+static constexpr uint32_t guest_map_shared     = 0x01;
+static constexpr uint32_t guest_map_private    = 0x02;
+static constexpr uint32_t guest_map_type       = 0x0f;
+static constexpr uint32_t guest_map_fixed      = 0x10;
+static constexpr uint32_t guest_map_anonymous  = 0x20;
+
+//Clocks clock_gettime knows, the rest being CPU time clocks read as monotonic
+static constexpr uint32_t guest_clock_realtime = 0;
+static constexpr uint32_t guest_clock_max      = 7;
+
+static constexpr uint32_t guest_stat_size = 128;       //newlib's struct kernel_stat
+static constexpr uint32_t path_max = 4096;
+
+/**
+ * Reads from a host file at an offset without moving its position, as
+ * pread does
+ *
+ * @param   fd: host file descriptor
+ * @param    p: where to put the bytes
+ * @param    n: how many to read
+ * @param  pos: offset in the file to read from
+ *
+ * @return: bytes read, or -1 with errno set
+ **/
+static int64_t read_at(int fd, void* p, uint32_t n, int64_t pos)
+{
+#if defined(_WIN32)
+	int64_t old = _lseeki64(fd, 0, SEEK_CUR);
+	if (old < 0 || _lseeki64(fd, pos, SEEK_SET) < 0)
+	{
+		return -1;
+	}
+	int64_t got = ::read(fd, p, n);
+	int e = errno;
+	_lseeki64(fd, old, SEEK_SET);
+	errno = e;
+	return got;
+#else
+	return ::pread(fd, p, n, static_cast<off_t>(pos));
+#endif
+}
+
+/**
+ * Each system call's name and how many arguments it takes
+ **/
+struct syscall_info
+{
+	uint32_t num;
+	const char* name;
+	uint32_t args;
+};
+
+static const syscall_info syscall_table[] =
+{
+	{ syscall_openat,          "openat",          4 },
+	{ syscall_close,           "close",           1 },
+	{ syscall_lseek,           "lseek",           3 },
+	{ syscall_read,            "read",            3 },
+	{ syscall_write,           "write",           3 },
+	{ syscall_fstat,           "fstat",           2 },
+	{ syscall_exit,            "exit",            1 },
+	{ syscall_exit_group,      "exit_group",      1 },
+	{ syscall_clock_gettime,   "clock_gettime",   2 },
+	{ syscall_gettimeofday,    "gettimeofday",    2 },
+	{ syscall_brk,             "brk",             1 },
+	{ syscall_munmap,          "munmap",          2 },
+	{ syscall_mmap,            "mmap",            6 },
+	{ syscall_clock_gettime64, "clock_gettime64", 2 },
+};
+
+/**
+ * Turns a host errno into the Linux one a guest expects
+ *
+ * @param e: host errno
+ *
+ * @return: minus the Linux errno
+ **/
+static int32_t guest_error(int e)
+{
+	switch (e)
+	{
+	default:           return -guest_eio;
+	case ENOENT:       return -guest_enoent;
+	case EBADF:        return -guest_ebadf;
+	case EACCES:       return -guest_eacces;
+	case EEXIST:       return -guest_eexist;
+	case ENOTDIR:      return -guest_enotdir;
+	case EISDIR:       return -guest_eisdir;
+	case EINVAL:       return -guest_einval;
+	case EMFILE:       return -guest_emfile;
+	case ENOSPC:       return -guest_enospc;
+	case ESPIPE:       return -guest_espipe;
+	case ENAMETOOLONG: return -guest_enametoolong;
+	}
+}
+
+/**
+ * Creates an emulator whose guest has just standard input, output and error
+ * open
+ *
+ * @param m: memory the guest's buffers are in
+ **/
+syscalls::syscalls(memory* m) : mem(m), files({ 0, 1, 2 }), map_end(0)
+{
+}
+
+/**
+ * Closes every host file the guest left open
+ **/
+syscalls::~syscalls()
+{
+	for (size_t fd = 3; fd < files.size(); fd++)
+	{
+		if (files[fd] >= 0)
+		{
+			::close(files[fd]);
+		}
+	}
+}
+
+/**
+ * Makes a system call for the guest
+ *
+ * @param  num: system call number, from a7
+ * @param args: its arguments, from a0 to a5
+ * @param exited: set if the call was exit or exit_group
+ *
+ * @return: what goes in a0, or the exit status if exited
+ **/
+int32_t syscalls::call(uint32_t num, const uint32_t* args, bool& exited)
+{
+	lock_guard<mutex> guard(lock);
+
+	exited = false;
+	switch (num)
+	{
+	default:
+		return -guest_enosys;
+	case syscall_exit:
+	case syscall_exit_group:
+		exited = true;
+		return args[0];
+	case syscall_openat:
+		return sys_openat(args);
+	case syscall_close:
+		return sys_close(args);
+	case syscall_lseek:
+		return sys_lseek(args);
+	case syscall_read:
+		return sys_read(args);
+	case syscall_write:
+		return sys_write(args);
+	case syscall_fstat:
+		return sys_fstat(args);
+	case syscall_brk:
+		return sys_brk(args);
+	case syscall_munmap:
+		return sys_munmap(args);
+	case syscall_mmap:
+		return sys_mmap(args);
+	case syscall_gettimeofday:
+		return sys_gettimeofday(args);
+	case syscall_clock_gettime:
+	case syscall_clock_gettime64:
+		return sys_clock_gettime(args);
+	}
+}
+
+/**
+ * Gives the name a system call is printed with
+ *
+ * @param num: system call number
+ *
+ * @return: its name, or nullptr if it is not emulated
+ **/
+const char* syscalls::name(uint32_t num)
+{
+	for (const syscall_info& s : syscall_table)
+	{
+		if (s.num == num)
+		{
+			return s.name;
+		}
+	}
+	return nullptr;
+}
+
+/**
+ * Gives how many arguments a system call takes
+ *
+ * @param num: system call number
+ *
+ * @return: its argument count, 0 if it is not emulated
+ **/
+uint32_t syscalls::arg_count(uint32_t num)
+{
+	for (const syscall_info& s : syscall_table)
+	{
+		if (s.num == num)
+		{
+			return s.args;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Checks that a guest buffer lies wholly in memory
+ *
+ * @param addr: start of the buffer
+ * @param  len: its length in bytes
+ *
+ * @return: true if every byte is in memory
+ **/
+bool syscalls::in_memory(uint32_t addr, uint32_t len) const
+{
+	return static_cast<uint64_t>(addr) + len <= mem->get_size();
+}
+
+/**
+ * Reads a NUL terminated string out of guest memory
+ *
+ * @param addr: where the string starts
+ * @param    s: where to put it
+ *
+ * @return: false if it runs off the end of memory or past path_max
+ **/
+bool syscalls::read_string(uint32_t addr, std::string& s) const
+{
+	s.clear();
+	for (uint32_t i = 0; i < path_max; i++)
+	{
+		if (!in_memory(addr + i, 1))
+		{
+			return false;
+		}
+
+		char c = mem->get8(addr + i);
+		if (c == 0)
+		{
+			return true;
+		}
+		s.push_back(c);
+	}
+	return false;
+}
+
+/**
+ * Writes a little-endian word of a result structure to guest memory
+ *
+ * @param addr: where to write it, already checked
+ * @param    v: the word
+ **/
+void syscalls::put32(uint32_t addr, uint32_t v)
+{
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		mem->set8(addr + i, v >> (8 * i));
+	}
+}
+
+/**
+ * Writes a little-endian 64 bit field of a result structure to guest memory
+ *
+ * @param addr: where to write it, already checked
+ * @param    v: the value
+ **/
+void syscalls::put64(uint32_t addr, uint64_t v)
+{
+	put32(addr, static_cast<uint32_t>(v));
+	put32(addr + 4, static_cast<uint32_t>(v >> 32));
+}
+
+/**
+ * Finds the host file descriptor a guest one stands for
+ *
+ * @param fd: guest file descriptor
+ *
+ * @return: host file descriptor, or -1 if the guest has no such file open
+ **/
+int syscalls::host_fd(uint32_t fd) const
+{
+	return fd < files.size() ? files[fd] : -1;
+}
+
+/**
+ * openat(dirfd, path, flags, mode): opens a host file. Paths are the host's,
+ * relative ones from the simulator's working directory, so dirfd must be
+ * AT_FDCWD unless the path is absolute.
+ *
+ * @param args: the call's arguments
+ *
+ * @return: new guest file descriptor, or minus an errno
+ **/
+int32_t syscalls::sys_openat(const uint32_t* args)
+{
+	std::string path;
+	if (!read_string(args[1], path))
+	{
+		return -guest_efault;
+	}
+	if (static_cast<int32_t>(args[0]) != guest_at_fdcwd && (path.empty() || path[0] != '/'))
+	{
+		return -guest_ebadf;
+	}
+
+	uint32_t flags = args[2];
+	int host_flags = O_RDONLY;
+	if ((flags & guest_o_accmode) == guest_o_wronly)
+	{
+		host_flags = O_WRONLY;
+	}
+	else if ((flags & guest_o_accmode) == guest_o_rdwr)
+	{
+		host_flags = O_RDWR;
+	}
+	if (flags & guest_o_creat)
+	{
+		host_flags |= O_CREAT;
+	}
+	if (flags & guest_o_excl)
+	{
+		host_flags |= O_EXCL;
+	}
+	if (flags & guest_o_trunc)
+	{
+		host_flags |= O_TRUNC;
+	}
+	if (flags & guest_o_append)
+	{
+		host_flags |= O_APPEND;
+	}
+#if defined(_WIN32)
+	host_flags |= O_BINARY;
+#endif
+
+	int host = ::open(path.c_str(), host_flags, args[3]);
+	if (host < 0)
+	{
+		return guest_error(errno);
+	}
+
+	//Takes the lowest free guest descriptor, as Linux would
+	for (size_t fd = 0; fd < files.size(); fd++)
+	{
+		if (files[fd] < 0)
+		{
+			files[fd] = host;
+			return fd;
+		}
+	}
+	files.push_back(host);
+	return files.size() - 1;
+}
+
+/**
+ * close(fd): closes a guest file. The simulator's own standard streams stay
+ * open underneath.
+ *
+ * @param args: the call's arguments
+ *
+ * @return: 0, or minus an errno
+ **/
+int32_t syscalls::sys_close(const uint32_t* args)
+{
+	int host = host_fd(args[0]);
+	if (host < 0)
+	{
+		return -guest_ebadf;
+	}
+
+	files[args[0]] = -1;
+	if (args[0] > 2 && ::close(host) < 0)
+	{
+		return guest_error(errno);
+	}
+	return 0;
+}
+
+/**
+ * lseek(fd, offset, whence): moves a guest file's position. Offsets are 32
+ * bits, as newlib passes them.
+ *
+ * @param args: the call's arguments
+ *
+ * @return: new position, or minus an errno
+ **/
+int32_t syscalls::sys_lseek(const uint32_t* args)
+{
+	int host = host_fd(args[0]);
+	if (host < 0)
+	{
+		return -guest_ebadf;
+	}
+
+	int64_t pos = ::lseek(host, static_cast<int32_t>(args[1]), args[2]);
+	if (pos < 0)
+	{
+		return guest_error(errno);
+	}
+	if (pos > INT32_MAX)
+	{
+		return -guest_eoverflow;
+	}
+	return static_cast<int32_t>(pos);
+}
+
+/**
+ * read(fd, buf, count): reads from a guest file straight into guest memory,
+ * a run of contiguous memory per host call. It stops early at the end of the
+ * file or once a pipe or terminal has given what it has.
+ *
+ * @param args: the call's arguments
+ *
+ * @return: bytes read, or minus an errno
+ **/
+int32_t syscalls::sys_read(const uint32_t* args)
+{
+	int host = host_fd(args[0]);
+	if (host < 0)
+	{
+		return -guest_ebadf;
+	}
+	if (!in_memory(args[1], args[2]))
+	{
+		return -guest_efault;
+	}
+
+	uint32_t done = 0;
+	while (done < args[2])
+	{
+		uint32_t want = args[2] - done;
+		uint8_t* p = mem->write_span(args[1] + done, want);
+		auto got = ::read(host, p, want);
+		if (got < 0)
+		{
+			return done > 0 ? static_cast<int32_t>(done) : guest_error(errno);
+		}
+
+		mem->span_written(args[1] + done, got);
+		done += got;
+
+		if (static_cast<uint32_t>(got) < want)
+		{
+			break;
+		}
+	}
+	return done;
+}
+
+/**
+ * write(fd, buf, count): writes guest memory straight to a guest file, a run
+ * of contiguous memory per host call
+ *
+ * @param args: the call's arguments
+ *
+ * @return: bytes written, or minus an errno
+ **/
+int32_t syscalls::sys_write(const uint32_t* args)
+{
+	int host = host_fd(args[0]);
+	if (host < 0)
+	{
+		return -guest_ebadf;
+	}
+	if (!in_memory(args[1], args[2]))
+	{
+		return -guest_efault;
+	}
+
+	uint32_t done = 0;
+	while (done < args[2])
+	{
+		uint32_t want = args[2] - done;
+		const uint8_t* p = mem->read_span(args[1] + done, want);
+
+		//Standard output and error go through the streams the simulator
+		//prints with, so they come out in order with it
+		if (host == 1 || host == 2)
+		{
+			if (host == 2)
+			{
+				cout.flush();
+			}
+			ostream& out = host == 1 ? cout : cerr;
+			if (!out.write(reinterpret_cast<const char*>(p), want))
+			{
+				out.clear();
+				return done > 0 ? static_cast<int32_t>(done) : -guest_eio;
+			}
+			done += want;
+			continue;
+		}
+
+		auto put = ::write(host, p, want);
+		if (put < 0)
+		{
+			return done > 0 ? static_cast<int32_t>(done) : guest_error(errno);
+		}
+		done += put;
+
+		if (static_cast<uint32_t>(put) < want)
+		{
+			break;
+		}
+	}
+	return done;
+}
+
+/**
+ * mmap(addr, length, prot, flags, fd, offset): gives the guest a file's
+ * contents, or zeros for an anonymous mapping, in its memory. All of guest
+ * memory already exists, so a mapping is a private copy read straight from
+ * the file into place, with anything past the end of the file, or past a
+ * read error once reading has begun, zero. It goes at addr with MAP_FIXED,
+ * 0 included. Otherwise addr is only a hint, which is ignored, since guest
+ * code, heap and stack could be under it, and the mapping goes at the
+ * program break, which is moved past it for good. Writes to a shared
+ * mapping could not reach the file, so writable ones are refused.
+ *
+ * Every check is made before memory is written, so a failed call leaves
+ * it as it was.
+ *
+ * @param args: the call's arguments
+ *
+ * @return: address of the mapping, or minus an errno
+ **/
+int32_t syscalls::sys_mmap(const uint32_t* args)
+{
+	uint32_t addr = args[0];
+	uint32_t flags = args[3];
+	uint32_t offset = args[5];
+	uint64_t length = (static_cast<uint64_t>(args[1]) + memory::page_size - 1) & ~static_cast<uint64_t>(memory::page_size - 1);
+
+	if (args[1] == 0 || (offset & (memory::page_size - 1)) != 0 || (addr & (memory::page_size - 1)) != 0)
+	{
+		return -guest_einval;
+	}
+	if ((flags & guest_map_type) != guest_map_private && (flags & guest_map_type) != guest_map_shared)
+	{
+		return -guest_einval;
+	}
+
+	int host = -1;
+	if (!(flags & guest_map_anonymous))
+	{
+		host = host_fd(args[4]);
+		if (host < 0)
+		{
+			return -guest_ebadf;
+		}
+		if ((flags & guest_map_type) == guest_map_shared && (args[2] & guest_prot_write))
+		{
+			return -guest_enodev;
+		}
+
+		//Makes sure the file can be read at offset, as pipes and files
+		//opened only for writing can not
+		char probe;
+		if (read_at(host, &probe, 1, offset) < 0)
+		{
+			return errno == EBADF ? -guest_eacces : errno == ESPIPE ? -guest_enodev : guest_error(errno);
+		}
+	}
+
+	//Places the mapping, taking it off the top of the heap if it must not
+	//go at addr
+	bool at_brk = !(flags & guest_map_fixed);
+	if (at_brk)
+	{
+		addr = (mem->get_brk() + memory::page_size - 1) & ~(memory::page_size - 1);
+	}
+	if (addr + length > mem->get_size())
+	{
+		return -guest_enomem;
+	}
+
+	//Reads the file into place, then zeroes whatever it did not fill
+	uint32_t done = 0;
+	while (host >= 0 && done < length)
+	{
+		uint32_t want = static_cast<uint32_t>(length - done);
+		uint8_t* p = mem->write_span(addr + done, want);
+		auto got = read_at(host, p, want, static_cast<int64_t>(offset) + done);
+		if (got < 0)
+		{
+			break;
+		}
+
+		mem->span_written(addr + done, got);
+		done += got;
+
+		if (static_cast<uint32_t>(got) < want)
+		{
+			break;
+		}
+	}
+	while (done < length)
+	{
+		uint32_t want = static_cast<uint32_t>(length - done);
+		uint8_t* p = mem->write_span(addr + done, want);
+		memset(p, 0, want);
+		mem->span_written(addr + done, want);
+		done += want;
+	}
+
+	if (at_brk)
+	{
+		mem->set_brk(static_cast<uint32_t>(addr + length));
+		map_end = mem->get_brk();
+	}
+	return addr;
+}
+
+/**
+ * munmap(addr, length): ends a mapping. Guest memory stays where it is, so
+ * this only checks the range.
+ *
+ * @param args: the call's arguments
+ *
+ * @return: 0, or minus an errno
+ **/
+int32_t syscalls::sys_munmap(const uint32_t* args)
+{
+	if (args[1] == 0 || (args[0] & (memory::page_size - 1)) != 0 || !in_memory(args[0], args[1]))
+	{
+		return -guest_einval;
+	}
+	return 0;
+}
+
+/**
+ * fstat(fd, statbuf): describes a guest file, in newlib's struct kernel_stat
+ * with 64 bit times
+ *
+ * @param args: the call's arguments
+ *
+ * @return: 0, or minus an errno
+ **/
+int32_t syscalls::sys_fstat(const uint32_t* args)
+{
+	int host = host_fd(args[0]);
+	if (host < 0)
+	{
+		return -guest_ebadf;
+	}
+	if (!in_memory(args[1], guest_stat_size))
+	{
+		return -guest_efault;
+	}
+
+	struct stat st;
+	if (::fstat(host, &st) < 0)
+	{
+		return guest_error(errno);
+	}
+
+	uint32_t a = args[1];
+	for (uint32_t i = 0; i < guest_stat_size; i += 4)
+	{
+		put32(a + i, 0);
+	}
+	put64(a + 0, st.st_dev);
+	put64(a + 8, st.st_ino);
+	put32(a + 16, st.st_mode);
+	put32(a + 20, st.st_nlink);
+	put32(a + 24, st.st_uid);
+	put32(a + 28, st.st_gid);
+	put64(a + 32, st.st_rdev);
+	put64(a + 48, st.st_size);
+#if !defined(_WIN32)
+	put32(a + 56, st.st_blksize);
+	put64(a + 64, st.st_blocks);
+#endif
+	put64(a + 72, st.st_atime);
+	put64(a + 88, st.st_mtime);
+	put64(a + 104, st.st_ctime);
+	return 0;
+}
+
+/**
+ * brk(addr): moves the program break, the end of the heap newlib's malloc
+ * grows. Asking for 0, anything outside memory or anything below a mapping
+ * mmap put at the break leaves it where it is.
+ *
+ * @param args: the call's arguments
+ *
+ * @return: the program break, moved or not
+ **/
+int32_t syscalls::sys_brk(const uint32_t* args)
+{
+	if (args[0] != 0 && args[0] <= mem->get_size() && args[0] >= map_end)
+	{
+		mem->set_brk(args[0]);
+	}
+	return mem->get_brk();
+}
+
+/**
+ * gettimeofday(tv, tz): the host's time of day, in a struct timeval with a
+ * 64 bit tv_sec as newlib has it. Any timezone is given as UTC.
+ *
+ * @param args: the call's arguments
+ *
+ * @return: 0, or minus an errno
+ **/
+int32_t syscalls::sys_gettimeofday(const uint32_t* args)
+{
+	if ((args[0] != 0 && !in_memory(args[0], 16)) || (args[1] != 0 && !in_memory(args[1], 8)))
+	{
+		return -guest_efault;
+	}
+
+	int64_t us = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+	if (args[0] != 0)
+	{
+		put64(args[0], us / 1000000);
+		put64(args[0] + 8, us % 1000000);
+	}
+	if (args[1] != 0)
+	{
+		put64(args[1], 0);
+	}
+	return 0;
+}
+
+/**
+ * clock_gettime(clock, tp): a clock's time in a struct timespec with a 64 bit
+ * tv_sec. CLOCK_REALTIME is the host's time of day and every other clock the
+ * host's monotonic clock.
+ *
+ * @param args: the call's arguments
+ *
+ * @return: 0, or minus an errno
+ **/
+int32_t syscalls::sys_clock_gettime(const uint32_t* args)
+{
+	if (args[0] > guest_clock_max)
+	{
+		return -guest_einval;
+	}
+	if (!in_memory(args[1], 16))
+	{
+		return -guest_efault;
+	}
+
+	int64_t ns;
+	if (args[0] == guest_clock_realtime)
+	{
+		ns = chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+	}
+	else
+	{
+		ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	put64(args[1], ns / 1000000000);
+	put64(args[1] + 8, ns % 1000000000);
+	return 0;
+}
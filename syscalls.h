@@ -0,0 +1,84 @@
+//*****************************************************************************
+//
+//  syscalls.h
+//  CSCI 463 Assignment 5
+//
+//  Created by Daniel Widing (z1838064)
+//
+//*****************************************************************************
+#ifndef syscalls_H
+#define syscalls_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "memory.h"
+
+//RISC-V Linux system call numbers, as newlib's libgloss makes them
+static constexpr uint32_t syscall_openat          = 56;
+static constexpr uint32_t syscall_close           = 57;
+static constexpr uint32_t syscall_lseek           = 62;
+static constexpr uint32_t syscall_read            = 63;
+static constexpr uint32_t syscall_write           = 64;
+static constexpr uint32_t syscall_fstat           = 80;
+static constexpr uint32_t syscall_exit            = 93;
+static constexpr uint32_t syscall_exit_group      = 94;
+static constexpr uint32_t syscall_clock_gettime   = 113;
+static constexpr uint32_t syscall_gettimeofday    = 169;
+static constexpr uint32_t syscall_brk             = 214;
+static constexpr uint32_t syscall_munmap          = 215;
+static constexpr uint32_t syscall_mmap            = 222;
+static constexpr uint32_t syscall_clock_gettime64 = 403;
+
+/**
+ * Emulates the Linux system calls a newlib program makes with ecall, on the
+ * host's files
+ *
+ * The guest's file descriptors are its own, each standing for a host one,
+ * so a guest can not close or write to files the simulator itself has open.
+ * 0, 1 and 2 are the simulator's standard input, output and error, with
+ * output written through cout so it stays in order with -i lines. Results
+ * are Linux's: a value, or minus a Linux errno. File data moves straight
+ * between host files and guest memory, with no copy in between. One
+ * emulator is shared by every hart over the same memory, and calls are made
+ * one at a time.
+ **/
+class syscalls
+{
+public:
+	syscalls(memory* m);
+	~syscalls();
+
+	int32_t call(uint32_t num, const uint32_t* args, bool& exited);
+
+	static const char* name(uint32_t num);
+	static uint32_t arg_count(uint32_t num);
+
+private:
+	memory* mem;
+	std::mutex lock;
+	std::vector<int> files;      //host file descriptor of each guest one, -1 once closed
+	uint32_t map_end;            //end of the last mapping mmap put at the program break
+
+	bool in_memory(uint32_t addr, uint32_t len) const;
+	bool read_string(uint32_t addr, std::string& s) const;
+	void put32(uint32_t addr, uint32_t v);
+	void put64(uint32_t addr, uint64_t v);
+	int host_fd(uint32_t fd) const;
+
+	int32_t sys_openat(const uint32_t* args);
+	int32_t sys_close(const uint32_t* args);
+	int32_t sys_lseek(const uint32_t* args);
+	int32_t sys_read(const uint32_t* args);
+	int32_t sys_write(const uint32_t* args);
+	int32_t sys_fstat(const uint32_t* args);
+	int32_t sys_brk(const uint32_t* args);
+	int32_t sys_mmap(const uint32_t* args);
+	int32_t sys_munmap(const uint32_t* args);
+	int32_t sys_gettimeofday(const uint32_t* args);
+	int32_t sys_clock_gettime(const uint32_t* args);
+};
+
+#endif
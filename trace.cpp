@@ -0,0 +1,616 @@
+//*****************************************************************************
+//
+//  trace.cpp
+//  CSCI 463 Assignment 5
+//
+//  Created by Daniel Widing (z1838064)
+//
+//*****************************************************************************
+#include <iostream>
+#include <cstring>
+#include <thread>
+
+#include "compressed.h"
+#include "rv32i.h"
+#include "trace.h"
+
+using namespace std;
+
+/**
+ * Gets the register a record's rd_val belongs to: rd, from the 32 bit
+ * instruction a compressed one expands to, or a0 for ecall, which holds the
+ * system call's result
+ *
+ * @param insn: the instruction, just its 16 bits if compressed
+ *
+ * @return: register number
+ **/
+static uint32_t insn_rd(uint32_t insn)
+{
+	if (is_compressed(insn))
+	{
+		insn = expand_compressed(insn);
+	}
+	if (insn == insn_ecall)
+	{
+		return 10;
+	}
+	return (insn >> 7) & 0x1f;
+}
+
+/**
+ * Creates an empty trace buffer in front of another stream buffer
+ *
+ * @param      out: stream buffer the collected output is written to
+ * @param capacity: bytes collected before they are written
+ **/
+trace_buffer::trace_buffer(std::streambuf* out, size_t capacity) : out(out), buf(capacity)
+{
+	setp(buf.data(), buf.data() + buf.size());
+}
+
+/**
+ * Writes out anything still collected
+ **/
+trace_buffer::~trace_buffer()
+{
+	flush();
+}
+
+/**
+ * Writes everything collected so far and flushes the stream buffer behind it
+ **/
+void trace_buffer::flush()
+{
+	out->sputn(pbase(), pptr() - pbase());
+	out->pubsync();
+	setp(buf.data(), buf.data() + buf.size());
+}
+
+/**
+ * Makes room when the buffer is full by writing it out
+ *
+ * @param c: character that did not fit, or eof
+ *
+ * @return: c, or something other than eof when c is eof
+ **/
+trace_buffer::int_type trace_buffer::overflow(int_type c)
+{
+	out->sputn(pbase(), pptr() - pbase());
+	setp(buf.data(), buf.data() + buf.size());
+
+	if (traits_type::eq_int_type(c, traits_type::eof()))
+	{
+		return traits_type::not_eof(c);
+	}
+
+	*pptr() = traits_type::to_char_type(c);
+	pbump(1);
+	return c;
+}
+
+/**
+ * Copies a run of characters into the buffer, writing it out as it fills
+ *
+ * @param s: characters to add
+ * @param n: how many
+ *
+ * @return: n
+ **/
+std::streamsize trace_buffer::xsputn(const char* s, std::streamsize n)
+{
+	std::streamsize left = n;
+	while (left > 0)
+	{
+		std::streamsize room = epptr() - pptr();
+		if (room == 0)
+		{
+			overflow(traits_type::eof());
+			room = epptr() - pptr();
+		}
+
+		std::streamsize count = left < room ? left : room;
+		memcpy(pptr(), s, count);
+		pbump(static_cast<int>(count));
+		s += count;
+		left -= count;
+	}
+
+	return n;
+}
+
+/**
+ * Ignores flushes asked for by the stream, the buffer is written when full
+ *
+ * @return: 0, always successful
+ **/
+int trace_buffer::sync()
+{
+	return 0;
+}
+
+/**
+ * Creates an empty queue
+ *
+ * @param capacity: records it can hold, rounded up to a power of 2
+ **/
+trace_queue::trace_queue(size_t capacity) : head(0), tail(0), closed(false)
+{
+	size_t n = 1;
+	while (n < capacity)
+	{
+		n <<= 1;
+	}
+
+	slots.resize(n);
+	mask = n - 1;
+}
+
+/**
+ * Adds a record, waiting for room if the queue is full
+ *
+ * @param r: record to add
+ **/
+void trace_queue::push(const trace_record& r)
+{
+	size_t t = tail.load(memory_order_relaxed);
+	while (t - head.load(memory_order_acquire) == slots.size())
+	{
+		this_thread::yield();
+	}
+
+	slots[t & mask] = r;
+	tail.store(t + 1, memory_order_release);
+}
+
+/**
+ * Takes the oldest record, waiting for one if the queue is empty
+ *
+ * @param r: filled in with the record
+ *
+ * @return: false once the queue is closed and empty
+ **/
+bool trace_queue::pop(trace_record& r)
+{
+	size_t h = head.load(memory_order_relaxed);
+	while (h == tail.load(memory_order_acquire))
+	{
+		if (closed.load(memory_order_acquire))
+		{
+			//Records pushed just before closing are still taken
+			if (h == tail.load(memory_order_acquire))
+			{
+				return false;
+			}
+			break;
+		}
+		this_thread::yield();
+	}
+
+	r = slots[h & mask];
+	head.store(h + 1, memory_order_release);
+	return true;
+}
+
+/**
+ * Marks that nothing more will be pushed, so pop returns false when empty
+ **/
+void trace_queue::close()
+{
+	closed.store(true, memory_order_release);
+}
+
+//Binary trace file layout
+static const char trace_magic[8] = { 'R', 'V', '3', '2', 'T', 'R', 'C', '1' };
+static constexpr uint8_t trace_pc_jump = 0x01;     //pc follows, as a change from the expected pc
+static constexpr uint8_t trace_rd      = 0x02;     //rd's value follows, as a change from its last value
+static constexpr uint8_t trace_mem     = 0x04;     //memory address and value follow
+static constexpr uint8_t trace_stop    = 0x80;     //end record
+
+/**
+ * Creates a writer with no file open
+ **/
+trace_writer::trace_writer() : regs(), next_pc(0), last_addr(0)
+{
+}
+
+/**
+ * Writes out anything still buffered
+ **/
+trace_writer::~trace_writer()
+{
+	if (!buf.empty())
+	{
+		out.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+	}
+}
+
+/**
+ * Creates the trace file
+ *
+ * @param fname: file to write
+ *
+ * @return: false if the file could not be created
+ **/
+bool trace_writer::open(const std::string& fname)
+{
+	out.open(fname, ios::out | ios::binary | ios::trunc);
+	if (!out.is_open())
+	{
+		cerr << "Can't open file \"" << fname << "\" for writing." << endl;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Writes the header, when the simulation starts
+ *
+ * @param mem_size: size of the simulated memory
+ * @param     regs: the 32 registers the simulation starts with
+ **/
+void trace_writer::start(uint32_t mem_size, const int32_t* regs)
+{
+	buf.reserve(flush_size + 64);
+	buf.insert(buf.end(), trace_magic, trace_magic + sizeof(trace_magic));
+	put32(mem_size);
+	for (int i = 0; i < 32; i++)
+	{
+		this->regs[i] = regs[i];
+		put32(regs[i]);
+	}
+}
+
+/**
+ * Adds the record of one executed instruction
+ *
+ * @param r: the instruction and what it changed
+ **/
+void trace_writer::record(const trace_record& r)
+{
+	uint8_t flags = 0;
+	if (r.pc != next_pc)
+	{
+		flags |= trace_pc_jump;
+	}
+	if (r.has_rd)
+	{
+		flags |= trace_rd;
+	}
+	if (r.has_mem)
+	{
+		flags |= trace_mem;
+	}
+
+	buf.push_back(flags);
+	if (r.pc != next_pc)
+	{
+		put_signed(static_cast<int32_t>(r.pc - next_pc));
+	}
+	if (is_compressed(r.insn))
+	{
+		put16(r.insn);
+	}
+	else
+	{
+		put32(r.insn);
+	}
+	if (r.has_rd)
+	{
+		uint32_t rd = insn_rd(r.insn);
+		put_signed(static_cast<int32_t>(r.rd_val - static_cast<uint32_t>(regs[rd])));
+		regs[rd] = r.rd_val;
+	}
+	if (r.has_mem)
+	{
+		put_signed(static_cast<int32_t>(r.mem_addr - last_addr));
+		put_varint(r.mem_val);
+		last_addr = r.mem_addr;
+	}
+	next_pc = r.pc + (is_compressed(r.insn) ? 2 : 4);
+
+	if (buf.size() >= flush_size)
+	{
+		out.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+		buf.clear();
+	}
+}
+
+/**
+ * Adds the end record and writes out the rest of the trace
+ *
+ * @param e: how the simulation ended
+ **/
+void trace_writer::finish(const trace_end& e)
+{
+	buf.push_back(trace_stop);
+	put32(e.pc);
+	put_varint(e.count);
+	buf.push_back(e.ebreak ? 1 : 0);
+
+	out.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+	out.flush();
+	buf.clear();
+}
+
+/**
+ * Appends a little-endian 16 bit value
+ *
+ * @param v: value to append
+ **/
+void trace_writer::put16(uint16_t v)
+{
+	buf.push_back(v);
+	buf.push_back(v >> 8);
+}
+
+/**
+ * Appends a little-endian 32 bit value
+ *
+ * @param v: value to append
+ **/
+void trace_writer::put32(uint32_t v)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		buf.push_back(v >> (8 * i));
+	}
+}
+
+/**
+ * Appends an unsigned LEB128 varint
+ *
+ * @param v: value to append
+ **/
+void trace_writer::put_varint(uint64_t v)
+{
+	while (v >= 0x80)
+	{
+		buf.push_back((v & 0x7f) | 0x80);
+		v >>= 7;
+	}
+	buf.push_back(v);
+}
+
+/**
+ * Appends a signed value zigzag encoded, so small changes either way are short
+ *
+ * @param v: value to append
+ **/
+void trace_writer::put_signed(int64_t v)
+{
+	put_varint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+}
+
+/**
+ * Creates a reader with no file open
+ **/
+trace_reader::trace_reader() : mem_size(0), start_regs(), regs(), next_pc(0), last_addr(0), end()
+{
+}
+
+/**
+ * Opens a trace file and reads its header
+ *
+ * @param fname: file to read
+ *
+ * @return: false if the file could not be opened or is not a trace
+ **/
+bool trace_reader::open(const std::string& fname)
+{
+	in.open(fname, ios::in | ios::binary);
+	if (!in.is_open())
+	{
+		cerr << "Can't open file \"" << fname << "\" for reading." << endl;
+		return false;
+	}
+
+	char magic[sizeof(trace_magic)];
+	if (!in.read(magic, sizeof(magic)) || memcmp(magic, trace_magic, sizeof(magic)) != 0 || !get32(mem_size))
+	{
+		cerr << "\"" << fname << "\" is not a trace file." << endl;
+		return false;
+	}
+
+	for (int i = 0; i < 32; i++)
+	{
+		uint32_t v;
+		if (!get32(v))
+		{
+			cerr << "\"" << fname << "\" is not a trace file." << endl;
+			return false;
+		}
+		start_regs[i] = v;
+		regs[i] = v;
+	}
+
+	return true;
+}
+
+/**
+ * Getter for the size of the traced simulation's memory
+ *
+ * @return: memory size
+ **/
+uint32_t trace_reader::get_mem_size() const
+{
+	return mem_size;
+}
+
+/**
+ * Getter for the registers the traced simulation started with
+ *
+ * @return: the 32 registers
+ **/
+const int32_t* trace_reader::get_start_regs() const
+{
+	return start_regs;
+}
+
+/**
+ * Reads the next instruction record
+ *
+ * @param r: filled in with the record
+ *
+ * @return: false at the end record or if the trace is cut short
+ **/
+bool trace_reader::next(trace_record& r)
+{
+	char c;
+	if (!in.get(c))
+	{
+		return false;
+	}
+
+	uint8_t flags = c;
+	if (flags & trace_stop)
+	{
+		uint64_t count = 0;
+		char ebreak = 0;
+		get32(end.pc);
+		get_varint(count);
+		in.get(ebreak);
+		end.count = count;
+		end.ebreak = ebreak != 0;
+		return false;
+	}
+
+	int64_t delta = 0;
+	if (flags & trace_pc_jump)
+	{
+		get_signed(delta);
+	}
+	r.pc = next_pc + static_cast<uint32_t>(delta);
+
+	//The second half of the instruction is only there if not compressed
+	uint16_t half = 0;
+	get16(half);
+	r.insn = half;
+	if (!is_compressed(r.insn))
+	{
+		get16(half);
+		r.insn |= static_cast<uint32_t>(half) << 16;
+	}
+	next_pc = r.pc + (is_compressed(r.insn) ? 2 : 4);
+
+	r.has_rd = (flags & trace_rd) != 0;
+	r.rd_val = 0;
+	if (r.has_rd)
+	{
+		uint32_t rd = insn_rd(r.insn);
+		get_signed(delta);
+		regs[rd] = static_cast<uint32_t>(regs[rd]) + static_cast<uint32_t>(delta);
+		r.rd_val = regs[rd];
+	}
+
+	r.has_mem = (flags & trace_mem) != 0;
+	r.mem_addr = 0;
+	r.mem_val = 0;
+	if (r.has_mem)
+	{
+		uint64_t val = 0;
+		get_signed(delta);
+		get_varint(val);
+		last_addr += static_cast<uint32_t>(delta);
+		r.mem_addr = last_addr;
+		r.mem_val = static_cast<uint32_t>(val);
+	}
+
+	return static_cast<bool>(in);
+}
+
+/**
+ * Getter for how the traced simulation ended, once next has returned false
+ *
+ * @return: the end record
+ **/
+const trace_end& trace_reader::get_end() const
+{
+	return end;
+}
+
+/**
+ * Reads a little-endian 16 bit value
+ *
+ * @param v: filled in with the value
+ *
+ * @return: false if the file ended
+ **/
+bool trace_reader::get16(uint16_t& v)
+{
+	uint8_t b[2];
+	if (!in.read(reinterpret_cast<char*>(b), sizeof(b)))
+	{
+		return false;
+	}
+
+	v = b[0] | (b[1] << 8);
+	return true;
+}
+
+/**
+ * Reads a little-endian 32 bit value
+ *
+ * @param v: filled in with the value
+ *
+ * @return: false if the file ended
+ **/
+bool trace_reader::get32(uint32_t& v)
+{
+	uint8_t b[4];
+	if (!in.read(reinterpret_cast<char*>(b), sizeof(b)))
+	{
+		return false;
+	}
+
+	v = b[0] | (b[1] << 8) | (b[2] << 16) | (static_cast<uint32_t>(b[3]) << 24);
+	return true;
+}
+
+/**
+ * Reads an unsigned LEB128 varint
+ *
+ * @param v: filled in with the value
+ *
+ * @return: false if the file ended
+ **/
+bool trace_reader::get_varint(uint64_t& v)
+{
+	v = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		char c;
+		if (!in.get(c))
+		{
+			return false;
+		}
+
+		v |= static_cast<uint64_t>(c & 0x7f) << shift;
+		if ((c & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Reads a zigzag encoded signed value
+ *
+ * @param v: filled in with the value
+ *
+ * @return: false if the file ended
+ **/
+bool trace_reader::get_signed(int64_t& v)
+{
+	uint64_t u;
+	if (!get_varint(u))
+	{
+		return false;
+	}
+
+	v = static_cast<int64_t>(u >> 1) ^ -static_cast<int64_t>(u & 1);
+	return true;
+}
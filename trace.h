@@ -0,0 +1,164 @@
+//*****************************************************************************
+//
+//  trace.h
+//  CSCI 463 Assignment 5
+//
+//  Created by Daniel Widing (z1838064)
+//
+//*****************************************************************************
+#ifndef trace_H
+#define trace_H
+
+#include <atomic>
+#include <fstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Output buffer for simulation traces
+ *
+ * Installed under cout while the simulation runs, it collects everything
+ * written into one large reusable buffer and hands it on in big chunks.
+ * Flushes asked for by endl are ignored; the buffer is only written out when
+ * it fills or flush is called, so the output is the same bytes in the same
+ * order, just without a write per line.
+ **/
+class trace_buffer : public std::streambuf
+{
+public:
+	static constexpr size_t default_capacity = 1 << 20;
+
+	trace_buffer(std::streambuf* out, size_t capacity = default_capacity);
+	~trace_buffer();
+
+	void flush();
+
+protected:
+	int_type overflow(int_type c) override;
+	std::streamsize xsputn(const char* s, std::streamsize n) override;
+	int sync() override;
+
+private:
+	std::streambuf* out;      //where the collected output goes
+	std::vector<char> buf;    //output not yet written
+};
+
+/**
+ * One executed instruction of a binary trace
+ **/
+struct trace_record
+{
+	uint32_t pc;           //address of the instruction
+	uint32_t insn;         //the instruction, just its 16 bits if compressed
+	bool has_rd;           //rd (taken from insn) was written, a CSR was read, sc.w ran or a system call made
+	int32_t rd_val;        //value written to rd, the CSR value or sc.w result even if rd is x0, or a0 after the call
+	bool has_mem;          //the instruction loaded or stored
+	uint32_t mem_addr;     //address loaded from or stored to
+	uint32_t mem_val;      //bytes loaded or stored, zero extended
+};
+
+/**
+ * How a traced simulation ended
+ **/
+struct trace_end
+{
+	uint32_t pc;           //pc when the simulation stopped
+	uint64_t count;        //instructions executed
+	bool ebreak;           //stopped on an EBREAK instruction
+};
+
+/**
+ * Lock-free queue of trace records from the simulation thread to a writer
+ * thread, for one producer and one consumer
+ *
+ * push waits while the queue is full, so a slow writer holds the simulation
+ * back rather than records being lost or memory growing.
+ **/
+class trace_queue
+{
+public:
+	static constexpr size_t default_capacity = 1 << 16;
+
+	trace_queue(size_t capacity = default_capacity);
+
+	void push(const trace_record& r);
+	bool pop(trace_record& r);
+	void close();
+
+private:
+	std::vector<trace_record> slots;     //capacity is a power of 2
+	size_t mask;
+	alignas(64) std::atomic<size_t> head;      //next slot to pop, written by the consumer
+	alignas(64) std::atomic<size_t> tail;      //next slot to push, written by the producer
+	alignas(64) std::atomic<bool> closed;      //no more records will be pushed
+};
+
+/**
+ * Writes a compact binary trace of a simulation
+ *
+ * The file starts with a header holding the memory size and the registers
+ * the simulation started with. Each record then has a flag byte, the pc only
+ * when it is not the one after the last instruction, the instruction (2
+ * bytes if compressed, 4 otherwise), and rd's value and the memory address as
+ * zigzag varints of the change from the last ones, so most instructions take
+ * 3 to 7 bytes. An end record holds how the simulation stopped.
+ **/
+class trace_writer
+{
+public:
+	trace_writer();
+	~trace_writer();
+
+	bool open(const std::string& fname);
+	void start(uint32_t mem_size, const int32_t* regs);
+	void record(const trace_record& r);
+	void finish(const trace_end& e);
+
+private:
+	static constexpr size_t flush_size = 1 << 20;
+
+	std::ofstream out;
+	std::vector<uint8_t> buf;     //encoded records not yet written
+	int32_t regs[32];             //register values as of the last record
+	uint32_t next_pc;             //pc the next record is expected at
+	uint32_t last_addr;           //memory address of the last load or store
+
+	void put16(uint16_t v);
+	void put32(uint32_t v);
+	void put_varint(uint64_t v);
+	void put_signed(int64_t v);
+};
+
+/**
+ * Reads a binary trace written by trace_writer, one record at a time
+ **/
+class trace_reader
+{
+public:
+	trace_reader();
+
+	bool open(const std::string& fname);
+	uint32_t get_mem_size() const;
+	const int32_t* get_start_regs() const;
+	bool next(trace_record& r);
+	const trace_end& get_end() const;
+
+private:
+	std::ifstream in;
+	uint32_t mem_size;
+	int32_t start_regs[32];       //registers the simulation started with
+	int32_t regs[32];             //register values as of the last record
+	uint32_t next_pc;
+	uint32_t last_addr;
+	trace_end end;
+
+	bool get16(uint16_t& v);
+	bool get32(uint32_t& v);
+	bool get_varint(uint64_t& v);
+	bool get_signed(int64_t& v);
+};
+
+#endif